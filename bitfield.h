@@ -1,26 +1,24 @@
 #ifndef __BITFIELD_H__
 #define __BITFIELD_H__
+
+// every loop over the words runs this many times, known at compile time,
+// so they unroll into a handful of word ops whatever the circuit's size
+const int BITFIELD_WORDS = 4;
+
 struct bitfield {
-    // assumption: we never have more than 256 nets.  we can get this from  
-    unsigned long long bits[4];
+    // labels (nets or cells) run from 0 to 64*BITFIELD_WORDS - 1
+    unsigned long long bits[BITFIELD_WORDS];
     int size;
 
     bool get(int net_num) {
-        assert(net_num < 256);
-        unsigned long long chunk = net_num/64;
-        unsigned long long rem = net_num%64;
-        unsigned long long mask = (1ULL<<rem);
-        if ((bits[chunk] & mask) > 0ULL) {
-            return true;
-        }
-        return false;
+        assert(net_num < 64*BITFIELD_WORDS);
+        return (bits[net_num >> 6] >> (net_num & 63)) & 1ULL;
     };
 
     void set(int net_num) {
-        assert(net_num < 256);
-        unsigned long long chunk = net_num/64;
-        unsigned long long rem = net_num%64;
-        unsigned long long mask = (1ULL<<rem);
+        assert(net_num < 64*BITFIELD_WORDS);
+        unsigned long long chunk = net_num >> 6;
+        unsigned long long mask = 1ULL << (net_num & 63);
         if ((bits[chunk] & mask) == 0ULL) { //only increment if bit was initially zero
             ++size;
         }
@@ -28,43 +26,38 @@ struct bitfield {
     };
 
     void clear(int net_num) {
-        assert(net_num < 256);
-        unsigned long long chunk = net_num/64;
-        unsigned long long rem = net_num%64;
-        unsigned long long mask = ~(1ULL<<rem);
-        if (get(net_num)) {
+        assert(net_num < 64*BITFIELD_WORDS);
+        unsigned long long chunk = net_num >> 6;
+        unsigned long long mask = 1ULL << (net_num & 63);
+        if ((bits[chunk] & mask) != 0ULL) {
             --size;
         }
-        bits[chunk] &= mask;
+        bits[chunk] &= ~mask;
+    };
+
+    // size from the words, after they were combined wholesale
+    void recount() {
+        size = 0;
+        for(int i = 0; i < BITFIELD_WORDS; ++i) {
+            size += __builtin_popcountll(bits[i]);
+        }
     };
 
     bitfield union_with(bitfield& other) {
         bitfield result;
-        for(int i = 0; i < 4; ++i) {
+        for(int i = 0; i < BITFIELD_WORDS; ++i) {
             result.bits[i] = bits[i] | other.bits[i];
         }
-        // fix size
-        result.size = 0;
-        for (int i = 0; i < 256; ++i) {
-            if (result.get(i)) {
-                result.size++;
-            }
-        }
+        result.recount();
         return result;
     };
 
     bitfield intersection_with(bitfield& other) {
         bitfield result;
-        for(int i = 0; i < 4; ++i) {
+        for(int i = 0; i < BITFIELD_WORDS; ++i) {
             result.bits[i] = bits[i] & other.bits[i];
         }
-        // fix size
-        result.size = 0;
-        for (int i = 0; i < 256; ++i) {
-            if (result.get(i)) {
-                result.size++;
-            }
-        }
+        result.recount();
         return result;
     };
 
@@ -74,13 +67,21 @@ struct bitfield {
         size = other->size;
     };
 
-    std::vector<int> to_vec() {
-        std::vector<int> ret;
-        for(int i = 0; i < 256; ++i) {
-            if (get(i)) {
-                ret.push_back(i);
+    // calls f on each set label, in order, without scanning every label
+    template<typename F> void for_each(F f) {
+        for(int i = 0; i < BITFIELD_WORDS; ++i) {
+            unsigned long long w = bits[i];
+            while (w != 0ULL) {
+                f(i*64 + __builtin_ctzll(w));
+                w &= w - 1;
             }
         }
+    };
+
+    std::vector<int> to_vec() {
+        std::vector<int> ret;
+        ret.reserve(size);
+        for_each([&ret](int i) { ret.push_back(i); });
         return ret;
     };
 };
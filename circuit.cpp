@@ -15,6 +15,8 @@
 #include <unistd.h>
 #include <condition_variable>
 #include <cassert>
+#include <cerrno>
+#include <climits>
 
 using namespace std; 
 
@@ -28,6 +30,15 @@ circuit::circuit(string file) {
     string line;
     ifstream infile (file);
     spdlog::debug("Reading input file {}", file);
+    total_area = 0;
+    total_weight = 0;
+    balance = 0.0;
+    explicit_capacities = false;
+    left_capacity = 0;
+    right_capacity = 0;
+    n_dropped_nets = 0;
+    n_folded_nets = 0;
+    parse_ok = true;
 
     if (infile.is_open()) {
 
@@ -47,21 +58,165 @@ circuit::circuit(string file) {
             }
 
         }
+
+        // optional annotations after the cell list:
+        //   weight <net> <w>
+        //   area <cell> <a>
+        //   fix <cell> <L|R>
+        // terminated by -1 or end of file
+        while (getline(infile, line)) {
+            std::stringstream ss(line);
+            istream_iterator<std::string> begin(ss);
+            istream_iterator<std::string> end;
+            vector<string> vstrings(begin, end);
+
+            if (vstrings.empty()) {
+                continue;
+            }
+            if (vstrings[0] == "-1") {
+                break;
+            }
+            if (!add_annotation(vstrings)) {
+                parse_ok = false;
+            }
+        }
         infile.close();
     } else {
         spdlog::error("Could not open {}", file);
+        parse_ok = false;
+    }
+
+    for(auto c : cells) {
+        total_area += c->area;
+    }
+    for(auto n : nets) {
+        total_weight += n->weight;
+    }
+    find_components();
+}
+
+// the whole token as a decimal int, without throwing on junk or overflow
+static bool parse_int(const string& s, int& value) {
+    char* end;
+    errno = 0;
+    long v = strtol(s.c_str(), &end, 10);
+    if (s.empty() || *end != '\0' || errno == ERANGE || v < INT_MIN || v > INT_MAX) {
+        return false;
+    }
+    value = (int)v;
+    return true;
+}
+
+bool circuit::add_annotation(vector<string> toks) {
+    int label, value;
+    if (toks.size() != 3 || !parse_int(toks[1], label)) {
+        spdlog::error("Malformed annotation: {}", toks[0]);
+        return false;
+    }
+
+    if (toks[0] == "fix") {
+        if (cellmap.find(label) == cellmap.end()) {
+            spdlog::error("fix given for unknown cell {}", label);
+            return false;
+        } else if (toks[2] == "L" || toks[2] == "l" || toks[2] == "0") {
+            fix_cell(label, false);
+        } else if (toks[2] == "R" || toks[2] == "r" || toks[2] == "1") {
+            fix_cell(label, true);
+        } else {
+            spdlog::error("fix side for cell {} must be L or R", label);
+            return false;
+        }
+        return true;
     }
+
+    if (!parse_int(toks[2], value)) {
+        spdlog::error("Malformed {} for {}: {}", toks[0], label, toks[2]);
+        return false;
+    }
+    if (value < 0) {
+        spdlog::error("Negative {} for {}", toks[0], label);
+        return false;
+    }
+
+    if (toks[0] == "weight") {
+        net* n = get_net(label);
+        if (n == nullptr) {
+            spdlog::error("weight given for unknown net {}", label);
+            return false;
+        }
+        n->weight = value;
+    } else if (toks[0] == "area") {
+        if (cellmap.find(label) == cellmap.end()) {
+            spdlog::error("area given for unknown cell {}", label);
+            return false;
+        }
+        cellmap[label]->area = value;
+    } else {
+        spdlog::error("Unknown annotation {}", toks[0]);
+        return false;
+    }
+    return true;
+}
+
+// a sub-circuit holding keep_cells and only those of their nets in keep_nets.
+// labels, areas and weights carry over from the parent
+circuit::circuit(circuit* parent, bitfield& keep_cells, bitfield& keep_nets) {
+    total_area = 0;
+    total_weight = 0;
+    balance = parent->balance;
+    explicit_capacities = false;
+    left_capacity = 0;
+    right_capacity = 0;
+    n_dropped_nets = 0;
+    n_folded_nets = 0;
+    parse_ok = true;
+
+    for(auto cl : keep_cells.to_vec()) {
+        cell* pc = parent->get_cell(cl);
+        cell* c = new cell(pc->label, pc->area);
+        cells.push_back(c);
+        cellmap[c->label] = c;
+
+        bitfield kept = pc->net_labels.intersection_with(keep_nets);
+        for(auto nl : kept.to_vec()) {
+            net* n = get_net(nl);
+            if (n == nullptr) {
+                n = new net(nl, parent->get_net(nl)->weight);
+                nets.push_back(n);
+                if (nl >= (int)net_by_label.size()) {
+                    net_by_label.resize(nl + 1, nullptr);
+                }
+                net_by_label[nl] = n;
+            }
+            c->add_net(nl);
+            n->add_cell(*c);
+        }
+    }
+
+    for(auto c : cells) {
+        total_area += c->area;
+    }
+    for(auto n : nets) {
+        total_weight += n->weight;
+    }
+    find_components();
 }
 
 net* circuit::get_net(int label) {
-    auto it = std::find_if(nets.begin(),nets.end(),[label](net* n){ return n->label == label; });
-    return *it;
+    if (label < 0 || label >= (int)net_by_label.size()) {
+        return nullptr;
+    }
+    return net_by_label[label];
 }
 
 void circuit::add_net(string s) {
     net* n = new net(s);
-    if (std::find_if(nets.begin(),nets.end(),[n](net* ne){return ne->label == n->label;}) == nets.end()) {
+    if (get_net(n->label) == nullptr) {
         nets.push_back(n);
+        if (n->label >= (int)net_by_label.size()) {
+            net_by_label.resize(n->label + 1, nullptr);
+        }
+        net_by_label[n->label] = n;
     } else {
         delete(n);
     }
@@ -82,8 +237,10 @@ void circuit::add_cell_connections(vector<string> toks) {
 
 }
 
+// a plain lookup that never inserts, so pool threads may share a circuit
 cell* circuit::get_cell(int label) {
-    return cellmap[label];
+    auto it = cellmap.find(label);
+    return it == cellmap.end() ? nullptr : it->second;
 }
 
 circuit::~circuit() {
@@ -95,12 +252,506 @@ circuit::~circuit() {
 	}
 }
 
+// node positions are fractions of the width, so it need not double per level
 double circuit::get_display_width() {
-    return PNODE_DIAMETER*(double)(2<<(get_n_cells()-1));
+    return ldexp(PNODE_DIAMETER, std::min(get_n_cells(), MAX_DISPLAY_LEVELS));
 }
 
 double circuit::get_display_height() {
-    return PNODE_DIAMETER*(double)(get_n_cells());
+    return PNODE_DIAMETER + PNODE_LEVEL_SPACING*get_n_cells();
+}
+
+void circuit::fix_cell(int label, bool right) {
+    if (right) {
+        fixed_left.clear(label);
+        fixed_right.set(label);
+    } else {
+        fixed_right.clear(label);
+        fixed_left.set(label);
+    }
+}
+
+// a zero area cell pinned to a side, e.g. a propagated terminal.
+// the nets have to exist already
+void circuit::add_fixed_cell(int label, bitfield& net_labels, bool right) {
+    cell* c = new cell(label, 0);
+    cells.push_back(c);
+    cellmap[label] = c;
+    for(auto nl : net_labels.to_vec()) {
+        c->add_net(nl);
+        get_net(nl)->add_cell(*c);
+    }
+    fix_cell(label, right);
+    find_components();
+}
+
+void circuit::remove_net(net* n) {
+    for(auto cl : n->cell_labels.to_vec()) {
+        get_cell(cl)->net_labels.clear(n->label);
+    }
+    net_by_label[n->label] = nullptr;
+    nets.erase(std::find(nets.begin(), nets.end(), n));
+    delete n;
+}
+
+// shrink the netlist without changing any cut:
+//   - nets on fewer than two cells can never be cut, so they go
+//   - nets on exactly the same cells are cut together, so they fold into
+//     the lowest labelled one, which takes their summed weight
+//   - free cells with the same nets and area could swap sides without
+//     changing the cost.  they are not merged (that would not be exact under
+//     the balance constraint) but grouped, so the search can ignore swaps
+void circuit::reduce() {
+    vector<net*> all = nets;
+    map<vector<unsigned long long>, net*> by_cells;
+    for(auto n : all) {
+        if (n->cell_labels.size < 2) {
+            total_weight -= n->weight;
+            n_dropped_nets++;
+            remove_net(n);
+            continue;
+        }
+        vector<unsigned long long> key(n->cell_labels.bits, n->cell_labels.bits + BITFIELD_WORDS);
+        auto it = by_cells.find(key);
+        if (it == by_cells.end()) {
+            by_cells[key] = n;
+            continue;
+        }
+        net* kept = it->second;
+        net* gone = n;
+        if (gone->label < kept->label) {
+            std::swap(kept, gone);
+            it->second = kept;
+        }
+        kept->weight += gone->weight;
+        merged_nets[kept->label].push_back(gone->label);
+        auto earlier = merged_nets.find(gone->label);
+        if (earlier != merged_nets.end()) {
+            for (auto nl : earlier->second) {
+                merged_nets[kept->label].push_back(nl);
+            }
+            merged_nets.erase(gone->label);
+        }
+        n_folded_nets++;
+        remove_net(gone);
+    }
+
+    cell_groups.clear();
+    map<pair<vector<unsigned long long>, int>, int> group_of;
+    for(auto c : cells) {
+        if (is_fixed(c->label)) {
+            continue;
+        }
+        auto key = make_pair(vector<unsigned long long>(c->net_labels.bits, c->net_labels.bits + BITFIELD_WORDS), c->area);
+        auto it = group_of.find(key);
+        if (it == group_of.end()) {
+            group_of[key] = cell_groups.size();
+            cell_groups.push_back({c->label});
+        } else {
+            cell_groups[it->second].push_back(c->label);
+        }
+    }
+    cell_groups.erase(std::remove_if(cell_groups.begin(), cell_groups.end(),
+                [](vector<int>& g) { return g.size() < 2; }), cell_groups.end());
+
+    find_components();
+}
+
+// the labels from the input file behind a set of (possibly merged) nets
+bitfield circuit::original_nets(bitfield& net_labels) {
+    bitfield result = net_labels;
+    for(auto nl : net_labels.to_vec()) {
+        auto it = merged_nets.find(nl);
+        if (it != merged_nets.end()) {
+            for(auto m : it->second) {
+                result.set(m);
+            }
+        }
+    }
+    return result;
+}
+
+/****
+*
+* symmetry detection
+*
+* colour refinement on the cell/net incidence graph splits the cells into
+* classes no automorphism can mix.  within a class, swapping two cells is
+* tried first: connected swaps make an orbit in which every order of the
+* cells is equivalent, and these go into cell_groups alongside the
+* identical cells from reduce().  for pairs still in different orbits, an
+* automorphism mapping one onto the other (e.g. swapping two whole bit
+* slices) is searched for by individualising cells until the colouring is
+* discrete.  that search does not backtrack, so it may miss some, but
+* anything it returns has been checked
+*
+****/
+
+// colours are renumbered by their sorted signatures, so two refinements of
+// isomorphic colourings come out with matching colours
+vector<int> circuit::refine_colors(vector<int> colors) {
+    int n_colors = -1;
+    vector<int> net_color(net_by_label.size(), -1);
+    while (true) {
+        map<pair<int, vector<int>>, int> net_sigs;
+        for(auto n : nets) {
+            vector<int> around;
+            for(auto cl : n->cell_labels.to_vec()) {
+                around.push_back(colors[cl]);
+            }
+            sort(around.begin(), around.end());
+            net_sigs[make_pair(n->weight, around)] = 0;
+        }
+        int id = 0;
+        for(auto& it : net_sigs) {
+            it.second = id++;
+        }
+        for(auto n : nets) {
+            vector<int> around;
+            for(auto cl : n->cell_labels.to_vec()) {
+                around.push_back(colors[cl]);
+            }
+            sort(around.begin(), around.end());
+            net_color[n->label] = net_sigs[make_pair(n->weight, around)];
+        }
+
+        map<pair<int, vector<int>>, int> cell_sigs;
+        vector<pair<int, vector<int>>> sig_of(64*BITFIELD_WORDS);
+        for(auto c : cells) {
+            vector<int> around;
+            for(auto nl : c->net_labels.to_vec()) {
+                around.push_back(net_color[nl]);
+            }
+            sort(around.begin(), around.end());
+            sig_of[c->label] = make_pair(colors[c->label], around);
+            cell_sigs[sig_of[c->label]] = 0;
+        }
+        id = 0;
+        for(auto& it : cell_sigs) {
+            it.second = id++;
+        }
+        for(auto c : cells) {
+            colors[c->label] = cell_sigs[sig_of[c->label]];
+        }
+        if (id == n_colors) {
+            return colors;
+        }
+        n_colors = id;
+    }
+}
+
+// perm maps cell labels to cell labels; it is an automorphism if it keeps
+// areas and fixed sides and carries every net onto a net of the same weight
+bool circuit::is_automorphism(vector<int>& perm) {
+    for(auto c : cells) {
+        cell* image = get_cell(perm[c->label]);
+        if (image->area != c->area || fixed_left.get(c->label) != fixed_left.get(image->label) ||
+                fixed_right.get(c->label) != fixed_right.get(image->label)) {
+            return false;
+        }
+    }
+    map<pair<vector<unsigned long long>, int>, int> count;
+    for(auto n : nets) {
+        count[make_pair(vector<unsigned long long>(n->cell_labels.bits, n->cell_labels.bits + BITFIELD_WORDS), n->weight)]++;
+    }
+    map<pair<vector<unsigned long long>, int>, int> image_count;
+    for(auto n : nets) {
+        bitfield image;
+        for(auto cl : n->cell_labels.to_vec()) {
+            image.set(perm[cl]);
+        }
+        image_count[make_pair(vector<unsigned long long>(image.bits, image.bits + BITFIELD_WORDS), n->weight)]++;
+    }
+    return count == image_count;
+}
+
+static vector<int> sorted_colors(vector<int>& colors, vector<cell*>& cells) {
+    vector<int> s;
+    for(auto c : cells) {
+        s.push_back(colors[c->label]);
+    }
+    sort(s.begin(), s.end());
+    return s;
+}
+
+bool circuit::find_automorphism(vector<int>& colors, int u, int v, vector<int>& perm) {
+    int fresh = *max_element(colors.begin(), colors.end()) + 1;
+    vector<int> a = colors, b = colors;
+    a[u] = fresh;
+    b[v] = fresh;
+    a = refine_colors(a);
+    b = refine_colors(b);
+
+    while (true) {
+        vector<int> sa = sorted_colors(a, cells);
+        if (sa != sorted_colors(b, cells)) {
+            return false;
+        }
+        // discrete: every cell has its own colour
+        int split = -1;
+        for(size_t i = 1; i < sa.size(); ++i) {
+            if (sa[i] == sa[i-1]) {
+                split = sa[i];
+                break;
+            }
+        }
+        if (split < 0) {
+            break;
+        }
+
+        fresh = sa.back() + 1;
+        int pick = -1;
+        for(auto c : cells) {
+            if (a[c->label] == split) {
+                pick = c->label;
+                break;
+            }
+        }
+        vector<int> next_a = a;
+        next_a[pick] = fresh;
+        next_a = refine_colors(next_a);
+        vector<int> target = sorted_colors(next_a, cells);
+
+        bool matched = false;
+        for(auto c : cells) {
+            if (b[c->label] != split) {
+                continue;
+            }
+            vector<int> next_b = b;
+            next_b[c->label] = fresh;
+            next_b = refine_colors(next_b);
+            if (sorted_colors(next_b, cells) == target) {
+                a = next_a;
+                b = next_b;
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            return false;
+        }
+    }
+
+    vector<int> cell_of_color(cells.size(), -1);
+    for(auto c : cells) {
+        cell_of_color[b[c->label]] = c->label;
+    }
+    perm = vector<int>(64*BITFIELD_WORDS);
+    for(int i = 0; i < 64*BITFIELD_WORDS; ++i) {
+        perm[i] = i;
+    }
+    for(auto c : cells) {
+        perm[c->label] = cell_of_color[a[c->label]];
+    }
+    return is_automorphism(perm);
+}
+
+static int orbit_root(vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        x = parent[x] = parent[parent[x]];
+    }
+    return x;
+}
+
+void circuit::find_symmetries() {
+    automorphisms.clear();
+    vector<int> colors(64*BITFIELD_WORDS, -1);
+    map<pair<int, int>, int> start;
+    for(auto c : cells) {
+        int side = fixed_left.get(c->label) ? 1 : (fixed_right.get(c->label) ? 2 : 0);
+        start[make_pair(c->area, side)] = 0;
+    }
+    int id = 0;
+    for(auto& it : start) {
+        it.second = id++;
+    }
+    for(auto c : cells) {
+        int side = fixed_left.get(c->label) ? 1 : (fixed_right.get(c->label) ? 2 : 0);
+        colors[c->label] = start[make_pair(c->area, side)];
+    }
+    colors = refine_colors(colors);
+
+    vector<int> swaps(64*BITFIELD_WORDS);
+    for(int i = 0; i < 64*BITFIELD_WORDS; ++i) {
+        swaps[i] = i;
+    }
+    vector<int> parent = swaps;
+    for(auto& g : cell_groups) {
+        for(auto cl : g) {
+            parent[orbit_root(parent, cl)] = orbit_root(parent, g[0]);
+        }
+    }
+
+    // cells that can trade places one for one
+    for(auto c : cells) {
+        for(auto d : cells) {
+            if (d->label <= c->label || colors[c->label] != colors[d->label] || is_fixed(c->label) ||
+                    orbit_root(parent, c->label) == orbit_root(parent, d->label)) {
+                continue;
+            }
+            swaps[c->label] = d->label;
+            swaps[d->label] = c->label;
+            if (is_automorphism(swaps)) {
+                parent[orbit_root(parent, d->label)] = orbit_root(parent, c->label);
+            }
+            swaps[c->label] = c->label;
+            swaps[d->label] = d->label;
+        }
+    }
+    map<int, vector<int>> orbits;
+    for(auto c : cells) {
+        orbits[orbit_root(parent, c->label)].push_back(c->label);
+    }
+    cell_groups.clear();
+    for(auto& it : orbits) {
+        if (it.second.size() > 1) {
+            cell_groups.push_back(it.second);
+        }
+    }
+
+    // larger automorphisms between cells the swaps did not connect
+    for(auto c : cells) {
+        for(auto d : cells) {
+            if (d->label <= c->label || colors[c->label] != colors[d->label] || is_fixed(c->label) ||
+                    orbit_root(parent, c->label) == orbit_root(parent, d->label)) {
+                continue;
+            }
+            vector<int> perm;
+            if (find_automorphism(colors, c->label, d->label, perm)) {
+                automorphisms.push_back(perm);
+                for(auto e : cells) {
+                    parent[orbit_root(parent, perm[e->label])] = orbit_root(parent, e->label);
+                }
+            }
+        }
+    }
+}
+
+// cells reachable from each other through nets, in order of their lowest
+// numbered cell.  cells on no net are components of their own
+void circuit::find_components() {
+    components.clear();
+    bitfield seen;
+    for(auto c : cells) {
+        if (seen.get(c->label)) {
+            continue;
+        }
+        bitfield comp;
+        queue<int> todo;
+        todo.push(c->label);
+        seen.set(c->label);
+        while (!todo.empty()) {
+            int cl = todo.front();
+            todo.pop();
+            comp.set(cl);
+            for(auto nl : get_cell(cl)->net_labels.to_vec()) {
+                for(auto other : get_net(nl)->cell_labels.to_vec()) {
+                    if (!seen.get(other)) {
+                        seen.set(other);
+                        todo.push(other);
+                    }
+                }
+            }
+        }
+        components.push_back(comp);
+    }
+}
+
+// a fixed-cell file holds 'fix <cell> <L|R>' lines, same as the netlist annotation
+bool circuit::load_fixed(string file) {
+    string line;
+    ifstream infile (file);
+    if (!infile.is_open()) {
+        spdlog::error("Could not open {}", file);
+        return false;
+    }
+    while (getline(infile, line)) {
+        std::stringstream ss(line);
+        istream_iterator<std::string> begin(ss);
+        istream_iterator<std::string> end;
+        vector<string> vstrings(begin, end);
+        if (vstrings.empty() || vstrings[0] == "-1") {
+            continue;
+        }
+        // areas and weights feed the totals, which are already summed
+        if (vstrings[0] != "fix") {
+            spdlog::error("{} may only hold fix lines, not {}", file, vstrings[0]);
+            return false;
+        }
+        if (!add_annotation(vstrings)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the most area either side may hold in a bisection.
+// with a balance tolerance e, each side may hold up to (0.5 + e) of the
+// total, so e = 0.05 allows a 45/55 split
+int circuit::get_side_capacity() {
+    int exact = (total_area + 1)/2;
+    int tolerant = (int)floor((0.5 + balance)*total_area + 1e-9);
+    return std::max(exact, tolerant);
+}
+
+int circuit::get_left_capacity() {
+    return explicit_capacities ? left_capacity : get_side_capacity();
+}
+
+int circuit::get_right_capacity() {
+    return explicit_capacities ? right_capacity : get_side_capacity();
+}
+
+// uneven splits, e.g. one step of a k-way partition when k is odd
+void circuit::set_capacities(int left, int right) {
+    explicit_capacities = true;
+    left_capacity = left;
+    right_capacity = right;
+}
+
+bool circuit::set_balance(double epsilon) {
+    if (epsilon < 0.0 || epsilon >= 0.5) {
+        spdlog::error("balance tolerance {} out of range [0, 0.5)", epsilon);
+        return false;
+    }
+    balance = epsilon;
+    explicit_capacities = false;
+    return true;
+}
+
+int circuit::weight_of(bitfield& net_labels) {
+    int w = 0;
+    net_labels.for_each([&](int nl) {
+        w += get_net(nl)->weight;
+    });
+    return w;
+}
+
+// FNV-1a over the cell/net incidence, used to make sure a checkpoint
+// is resumed against the same netlist it was written for
+unsigned long long circuit::signature() {
+    unsigned long long h = 14695981039346656037ULL;
+    auto mix = [&h](int v) {
+        h ^= (unsigned long long)v;
+        h *= 1099511628211ULL;
+    };
+    for(auto c : cells) {
+        mix(c->label);
+        mix(c->area);
+        for(auto nl : c->net_labels.to_vec()) {
+            mix(nl);
+            mix(get_net(nl)->weight);
+        }
+    }
+    mix(get_left_capacity());
+    mix(get_right_capacity());
+    for(auto cl : fixed_left.to_vec()) {
+        mix(-cl);
+    }
+    for(auto cl : fixed_right.to_vec()) {
+        mix(cl + (1 << 16));
+    }
+    return h;
 }
 
 /****
@@ -112,16 +763,26 @@ double circuit::get_display_height() {
 cell::cell(vector<string> s) {
     x = 0;
     y = 0;
+    area = 1;
     label = stoi(s[0]);
     //nets = std::vector<string>(s.begin()+1,s.end()-1);
 }
 
+cell::cell(int l, int a) {
+    x = 0;
+    y = 0;
+    label = l;
+    area = a;
+}
+
 // make a supercell
 cell::cell(vector<cell*> cells) {
     x = 0;
     y = 0;
     label = 0;
+    area = 0;
     for(auto& c : cells) {
+        area += c->area;
         for(auto& n: c->net_labels.to_vec()) {
             add_net(n);
         }
@@ -171,6 +832,12 @@ void net::add_cell(cell& c) {
     add_cell(c.label);
 }
 
+net::net(int l, int w) {
+    label = l;
+    weight = w;
+}
+
 net::net(string l) {
     label = stoi(l);
+    weight = 1;
 }
@@ -20,8 +20,10 @@ class net {
     public:
         bitfield cell_labels;
         int label;
+        int weight;
 
         net(string l);
+        net(int l, int w);
         bool operator==(const net& other) const {
             return this->label == other.label;
         }
@@ -36,7 +38,9 @@ class cell {
         double x;
         double y;
         int label;
+        int area;
         cell(vector<string> s);
+        cell(int l, int a);
         void connect(cell* other);
         int get_num_nets();
         void add_net(net& n);
@@ -55,10 +59,34 @@ class circuit {
         map<int, cell*> cellmap;
         vector<cell*> cells;
         vector<net*> nets;
+        vector<net*> net_by_label;
+        int total_area;
+        int total_weight;
+        double balance;
+        bool explicit_capacities;
+        int left_capacity;
+        int right_capacity;
+        bitfield fixed_left;
+        bitfield fixed_right;
+        vector<bitfield> components;
+        map<int, vector<int>> merged_nets;
+        vector<vector<int>> cell_groups;
+        int n_dropped_nets;
+        int n_folded_nets;
+        bool parse_ok;
+        vector<vector<int>> automorphisms;
+        void remove_net(net* n);
+        vector<int> refine_colors(vector<int> colors);
+        bool is_automorphism(vector<int>& perm);
+        bool find_automorphism(vector<int>& colors, int u, int v, vector<int>& perm);
+        bool add_annotation(vector<string> toks);
+        void find_components();
 
     public:
         circuit(string s);
         ~circuit();
+        // false if the netlist could not be read or had a bad annotation
+        bool parsed_ok() { return parse_ok; }
         int get_n_cells() { return cells.size();}
         int get_n_nets() { return nets.size();}
 
@@ -70,5 +98,37 @@ class circuit {
         vector<cell*> get_cells() {return cells;};
         double get_display_width();
         double get_display_height();
+        unsigned long long signature();
+
+        int get_total_area() { return total_area; }
+        int get_total_weight() { return total_weight; }
+        circuit(circuit* parent, bitfield& keep_cells, bitfield& keep_nets);
+        int get_side_capacity();
+        int get_left_capacity();
+        int get_right_capacity();
+        void set_capacities(int left, int right);
+        // false, and unchanged, outside [0, 0.5)
+        bool set_balance(double epsilon);
+        double get_balance() { return balance; }
+
+        bool load_fixed(string file);
+        void fix_cell(int label, bool right);
+        void add_fixed_cell(int label, bitfield& net_labels, bool right);
+        bitfield& get_fixed_left() { return fixed_left; }
+        bitfield& get_fixed_right() { return fixed_right; }
+        bool is_fixed(int label) { return fixed_left.get(label) || fixed_right.get(label); }
+        int get_n_fixed() { return fixed_left.size + fixed_right.size; }
+        int weight_of(bitfield& net_labels);
+        vector<bitfield>& get_components() { return components; }
+
+        void reduce();
+        int get_n_dropped_nets() { return n_dropped_nets; }
+        int get_n_folded_nets() { return n_folded_nets; }
+        map<int, vector<int>>& get_merged_nets() { return merged_nets; }
+        vector<vector<int>>& get_cell_groups() { return cell_groups; }
+        bitfield original_nets(bitfield& net_labels);
+
+        void find_symmetries();
+        vector<vector<int>>& get_automorphisms() { return automorphisms; }
 };
 #endif
@@ -0,0 +1,206 @@
+#include "components.h"
+#include "kway.h"
+#include "thread_pool.h"
+#include <climits>
+
+// a netlist that falls apart into independent components needs no search
+// across them: each component is bisected exactly for every left area it
+// could take, and a knapsack over the components picks the cheapest
+// combination the side capacities allow.  the components share no nets, so
+// the total cut is just the sum
+
+static circuit* component_circuit(circuit* c, bitfield& cells) {
+    bitfield all_nets;
+    for (auto n : c->get_nets()) {
+        all_nets.set(n->label);
+    }
+    circuit* sub = new circuit(c, cells, all_nets);
+    for (auto cl : cells.to_vec()) {
+        if (c->get_fixed_left().get(cl)) {
+            sub->fix_cell(cl, false);
+        } else if (c->get_fixed_right().get(cl)) {
+            sub->fix_cell(cl, true);
+        }
+    }
+    return sub;
+}
+
+static void solve_split(circuit* c, bitfield& cells, int left_area, a3::component_cuts* result) {
+    circuit* sub = component_circuit(c, cells);
+    sub->set_capacities(left_area, result->area - left_area);
+    // many small searches, so the random restarts would cost more than
+    // the searches themselves
+    a3::partition* p = a3::bisect(sub, 0, true);
+    // the capacities add up to the area, so balanced means exactly left_area
+    if (p->is_balanced()) {
+        result->cut[left_area] = p->cost();
+        result->left[left_area] = p->vl_cells;
+    }
+    delete p;
+    delete sub;
+}
+
+// the splits that need no search, and which ones do
+static void init_component(circuit* c, bitfield& cells, a3::component_cuts& r) {
+    r.cells = cells;
+    r.area = 0;
+    r.has_fixed = false;
+    bool has_fixed_left = false, has_fixed_right = false;
+    for (auto cl : cells.to_vec()) {
+        r.area += c->get_cell(cl)->area;
+        has_fixed_left |= c->get_fixed_left().get(cl);
+        has_fixed_right |= c->get_fixed_right().get(cl);
+    }
+    r.has_fixed = has_fixed_left || has_fixed_right;
+    r.cut = std::vector<int>(r.area + 1, INT_MAX);
+    r.left = std::vector<bitfield>(r.area + 1);
+
+    // everything on one side cuts nothing
+    if (!has_fixed_right) {
+        r.cut[r.area] = 0;
+        r.left[r.area] = cells;
+    }
+    if (!has_fixed_left) {
+        r.cut[0] = 0;
+    }
+}
+
+// without fixed cells the sides are interchangeable, so only the splits
+// with at most half the area on the left are searched
+static int last_searched(a3::component_cuts& r) {
+    return r.has_fixed ? r.area - 1 : r.area/2;
+}
+
+// the left areas some choice of the free cells adds up to
+static std::vector<bool> reachable_areas(circuit* c, a3::component_cuts& r) {
+    std::vector<bool> reachable(r.area + 1, false);
+    int fixed_left = 0;
+    std::vector<int> free_areas;
+    for (auto cl : r.cells.to_vec()) {
+        if (c->get_fixed_left().get(cl)) {
+            fixed_left += c->get_cell(cl)->area;
+        } else if (!c->get_fixed_right().get(cl)) {
+            free_areas.push_back(c->get_cell(cl)->area);
+        }
+    }
+    reachable[fixed_left] = true;
+    for (int a : free_areas) {
+        for (int l = r.area; l - a >= fixed_left; --l) {
+            if (reachable[l - a]) {
+                reachable[l] = true;
+            }
+        }
+    }
+    return reachable;
+}
+
+// one job per left area that needs a search and can be reached at all
+static void submit_splits(thread_pool& pool, circuit* c, a3::component_cuts& r) {
+    std::vector<bool> reachable = reachable_areas(c, r);
+    for (int a = 1; a <= last_searched(r); ++a) {
+        if (!reachable[a]) {
+            continue;
+        }
+        a3::component_cuts* result = &r;
+        pool.submit([c, a, result]() {
+            solve_split(c, result->cells, a, result);
+        });
+    }
+}
+
+static void mirror_splits(a3::component_cuts& r) {
+    if (r.has_fixed) {
+        return;
+    }
+    for (int a = last_searched(r) + 1; a < r.area; ++a) {
+        int other = r.area - a;
+        if (r.cut[other] != INT_MAX) {
+            r.cut[a] = r.cut[other];
+            bitfield rest = r.cells;
+            for (auto cl : r.left[other].to_vec()) {
+                rest.clear(cl);
+            }
+            r.left[a] = rest;
+        }
+    }
+}
+
+a3::component_cuts a3::solve_component(circuit* c, bitfield& cells, int n_threads) {
+    a3::component_cuts r;
+    init_component(c, cells, r);
+    thread_pool pool(n_threads);
+    submit_splits(pool, c, r);
+    pool.wait();
+    mirror_splits(r);
+    return r;
+}
+
+a3::partition* a3::solve_by_components(circuit* c, int n_threads) {
+    std::vector<bitfield>& comps = c->get_components();
+    int total = c->get_total_area();
+    spdlog::info("{} connected components", comps.size());
+
+    // every split of every component is its own job
+    std::vector<a3::component_cuts> solved(comps.size());
+    thread_pool pool(n_threads);
+    for (size_t i = 0; i < comps.size(); ++i) {
+        init_component(c, comps[i], solved[i]);
+        spdlog::debug("component {}: {} cells, area {}", i, comps[i].size, solved[i].area);
+        submit_splits(pool, c, solved[i]);
+    }
+    pool.wait();
+    for (auto& r : solved) {
+        mirror_splits(r);
+    }
+
+    // best[i][L]: least cut of the first i components with L area on the left
+    std::vector<std::vector<int>> best(comps.size() + 1, std::vector<int>(total + 1, INT_MAX));
+    std::vector<std::vector<int>> choice(comps.size() + 1, std::vector<int>(total + 1, -1));
+    best[0][0] = 0;
+    for (size_t i = 0; i < solved.size(); ++i) {
+        for (int l = 0; l <= total; ++l) {
+            if (best[i][l] == INT_MAX) {
+                continue;
+            }
+            for (int a = 0; a <= solved[i].area && l + a <= total; ++a) {
+                if (solved[i].cut[a] == INT_MAX) {
+                    continue;
+                }
+                int cost = best[i][l] + solved[i].cut[a];
+                if (cost < best[i+1][l+a]) {
+                    best[i+1][l+a] = cost;
+                    choice[i+1][l+a] = a;
+                }
+            }
+        }
+    }
+
+    int left_area = -1;
+    for (int l = 0; l <= total; ++l) {
+        if (l > c->get_left_capacity() || total - l > c->get_right_capacity()) {
+            continue;
+        }
+        if (best[comps.size()][l] != INT_MAX &&
+                (left_area == -1 || best[comps.size()][l] < best[comps.size()][left_area])) {
+            left_area = l;
+        }
+    }
+    if (left_area == -1) {
+        spdlog::error("no balanced bisection of {} cells", c->get_n_cells());
+        return nullptr;
+    }
+
+    bitfield left, right;
+    for (size_t i = comps.size(); i > 0; --i) {
+        int a = choice[i][left_area];
+        a3::component_cuts& s = solved[i-1];
+        for (auto cl : s.cells.to_vec()) {
+            s.left[a].get(cl) ? left.set(cl) : right.set(cl);
+        }
+        left_area -= a;
+    }
+
+    a3::partition* p = new a3::partition(c);
+    p->assign_from(left, right);
+    return p;
+}
@@ -0,0 +1,20 @@
+#ifndef __COMPONENTS_H__
+#define __COMPONENTS_H__
+#include "circuit.h"
+#include "partition.h"
+#include <vector>
+
+namespace a3 {
+    // min cut of one connected component for every area it could put left
+    struct component_cuts {
+        bitfield cells;
+        int area;
+        bool has_fixed;
+        std::vector<int> cut;           // INT_MAX where no split has that left area
+        std::vector<bitfield> left;     // the cells that go left for that cut
+    };
+
+    component_cuts solve_component(circuit* c, bitfield& cells, int n_threads);
+    a3::partition* solve_by_components(circuit* c, int n_threads);
+}
+#endif
@@ -388,6 +388,30 @@ static int which_button (Window win);
 static void turn_on_off (int pressed);
 static void drawmenu(void);
 
+/* Double buffering and batching.  User drawing goes to draw_target: the   *
+* toplevel window, or after drawtobuffer an off-screen pixmap that        *
+* displaybuffer copies over in one go, so redraws never flicker.  Lines,  *
+* arcs and rectangles are queued and sent as one XDrawSegments /          *
+* XDrawArcs / XFillRectangles (etc.) request per kind whenever the GC     *
+* changes, before text or polygons, and once per pass of the event loop,  *
+* rather than a round trip per primitive.                                 */
+#define MAX_BATCH 4096
+static Drawable draw_target;
+static Pixmap backbuffer = None;
+static int backbuffer_width = 0, backbuffer_height = 0;
+static XSegment batch_segments[MAX_BATCH];
+static XRectangle batch_rects[MAX_BATCH], batch_fill_rects[MAX_BATCH];
+static XArc batch_arcs[MAX_BATCH], batch_fill_arcs[MAX_BATCH];
+static int n_batch_segments = 0, n_batch_rects = 0, n_batch_fill_rects = 0,
+	n_batch_arcs = 0, n_batch_fill_arcs = 0;
+
+static void flush_batches (void);
+static void batch_segment (int x1, int y1, int x2, int y2);
+static void batch_rect (XRectangle *batch, int *n, int xl, int yt,
+						unsigned int width, unsigned int height);
+static void batch_arc (XArc *batch, int *n, int xl, int yt, unsigned int width,
+					   unsigned int height, int startang, int angextent);
+
 #endif /* X11 Declarations */
 
 
@@ -573,6 +597,7 @@ static void force_setcolor (int cindex)
 
 	if (disp_type == SCREEN) {
 #ifdef X11
+		flush_batches ();
 		XSetForeground (display, current_gc, colors[cindex]);
 #else /* Win32 */
 		if(!DeleteObject(hGraphicsPen))
@@ -623,6 +648,7 @@ static void force_setlinestyle (int linestyle)
 	
 	if (disp_type == SCREEN) {
 #ifdef X11
+		flush_batches ();
 		XSetLineAttributes (display, current_gc, currentlinewidth, x_vals[linestyle],
 			CapButt, JoinMiter);
 #else /* Win32 */
@@ -669,6 +695,7 @@ static void force_setlinewidth (int linewidth)
 	
 	if (disp_type == SCREEN) {
 #ifdef X11
+		flush_batches ();
 		XSetLineAttributes (display, current_gc, linewidth, x_vals[currentlinestyle],
 			CapButt, JoinMiter);
 #else /* Win32 */
@@ -1040,6 +1067,7 @@ init_graphics (const char *window_name, int cindex)
 	
 	/* Create default Graphics Contexts.  valuemask = 0 -> use defaults. */
 	current_gc = gc = XCreateGC(display, toplevel, valuemask, &values);
+	draw_target = toplevel;
 	gc_menus = XCreateGC(display, toplevel, valuemask, &values);
 	
 	/* Create XOR graphics context for Rubber Banding */
@@ -1303,6 +1331,9 @@ event_loop (void (*act_on_mousebutton)(float x, float y),
 	while (1) {
 	    long event_mask = ExposureMask | StructureNotifyMask |
 		ButtonPressMask | PointerMotionMask | KeyPressMask;
+
+		/* whatever the last callback drew goes out now */
+		flush_batches ();
 	
 		if (false == XCheckMaskEvent (display, event_mask, &report)){
             if (interval > 0UL) {
@@ -1434,7 +1465,17 @@ clearscreen (void)
    int savecolor;
    if (disp_type == SCREEN) {
 #ifdef X11
-      XClearWindow (display, toplevel);
+      /* whatever is still queued would be cleared anyway */
+      n_batch_segments = n_batch_rects = n_batch_fill_rects = 0;
+      n_batch_arcs = n_batch_fill_arcs = 0;
+      if (draw_target == toplevel) {
+         XClearWindow (display, toplevel);
+      }
+      else {
+         XSetForeground (display, gc, colors[background_cindex]);
+         XFillRectangle (display, backbuffer, gc, 0, 0, backbuffer_width, backbuffer_height);
+         XSetForeground (display, gc, colors[currentcolor]);
+      }
 #else /* Win32 */
       savecolor = currentcolor;
       setcolor(background_cindex);
@@ -1500,7 +1541,7 @@ drawline (float x1, float y1, float x2, float y2)
 	if (disp_type == SCREEN) {
 #ifdef X11
 		/* Xlib.h prototype has x2 and y1 mixed up. */ 
-		XDrawLine(display, toplevel, current_gc, xcoord(x1), ycoord(y1), xcoord(x2), ycoord(y2));
+		batch_segment (xcoord(x1), ycoord(y1), xcoord(x2), ycoord(y2));
 #else /* Win32 */
 		if(!(hOldPen = (HPEN)SelectObject(hGraphicsDC, hGraphicsPen)))
 			SELECT_ERROR();
@@ -1551,7 +1592,7 @@ drawrect (float x1, float y1, float x2, float y2)
 		yt = min(yw1,yw2);
 		width = abs (xw1-xw2);
 		height = abs (yw1-yw2);
-		XDrawRectangle(display, toplevel, current_gc, xl, yt, width, height);
+		batch_rect (batch_rects, &n_batch_rects, xl, yt, width, height);
 #else /* Win32 */
 		if(xw1 > xw2) {
 			int temp = xw1;
@@ -1611,7 +1652,7 @@ fillrect (float x1, float y1, float x2, float y2)
 		yt = min(yw1,yw2);
 		width = abs (xw1-xw2);
 		height = abs (yw1-yw2);
-		XFillRectangle(display, toplevel, current_gc, xl, yt, width, height);
+		batch_rect (batch_fill_rects, &n_batch_fill_rects, xl, yt, width, height);
 #else /* Win32 */
 		if(xw1 > xw2) {
 			int temp = xw1;
@@ -1688,7 +1729,7 @@ drawellipticarc (float xc, float yc, float radx, float rady, float startang, flo
 		width = (unsigned int) (2*fabs(xmult*radx));
 		height = (unsigned int) (2*fabs(ymult*rady));
 #ifdef X11
-		XDrawArc (display, toplevel, current_gc, xl, yt, width, height,
+		batch_arc (batch_arcs, &n_batch_arcs, xl, yt, width, height,
 			(int) (startang*64), (int) (angextent*64));
 #else  // Win32
 		/* set arc direction */
@@ -1769,7 +1810,7 @@ fillellipticarc (float xc, float yc, float radx, float rady, float startang,
 		width = (unsigned int) (2*fabs(xmult*radx));
 		height = (unsigned int) (2*fabs(ymult*rady));
 #ifdef X11
-		XFillArc (display, toplevel, current_gc, xl, yt, width, height,
+		batch_arc (batch_fill_arcs, &n_batch_fill_arcs, xl, yt, width, height,
 			(int) (startang*64), (int) (angextent*64));
 #else  // Win32
 		/* set pie direction */
@@ -1860,7 +1901,8 @@ fillpoly (t_point *points, int npoints)
 			transpoints[i].y = (short) ycoord (points[i].y);
 		}
 #ifdef X11
-		XFillPolygon(display, toplevel, current_gc, transpoints, npoints, Complex,
+		flush_batches ();
+		XFillPolygon(display, draw_target, current_gc, transpoints, npoints, Complex,
 			CoordModeOrigin);
 #else
 		if(!(hOldPen = (HPEN)SelectObject(hGraphicsDC, GetStockObject(NULL_PEN))))
@@ -1943,7 +1985,8 @@ drawtext (float xc, float yc, const char *text, float boundx)
 	
 	if (disp_type == SCREEN) {
 #ifdef X11
-		XDrawString(display, toplevel, current_gc, xcoord(xc)-width/2, ycoord(yc) + 
+		flush_batches ();
+		XDrawString(display, draw_target, current_gc, xcoord(xc)-width/2, ycoord(yc) + 
 			(font_info[currentfontsize]->ascent - font_info[currentfontsize]->descent)/2,
 			text, len);
 #else /* Win32 */
@@ -2361,6 +2404,10 @@ close_graphics (void)
 			XFreeFont(display,font_info[i]);
 	}
 	
+	if (backbuffer != None)
+		XFreePixmap (display, backbuffer);
+	backbuffer = None;
+
 	XFreeGC(display,gc);
 	XFreeGC(display,gcxor);
 	XFreeGC(display,gc_menus);
@@ -2783,6 +2830,7 @@ void set_draw_mode (enum e_draw_mode draw_mode) {
 
    if (draw_mode == DRAW_NORMAL) {
 #ifdef X11
+      flush_batches ();
       current_gc = gc;
 #else
       if (!SetROP2(hGraphicsDC, R2_COPYPEN))
@@ -2791,6 +2839,7 @@ void set_draw_mode (enum e_draw_mode draw_mode) {
    }
    else {  // DRAW_XOR
 #ifdef X11
+      flush_batches ();
       current_gc = gcxor;
 #else
       if (!SetROP2(hGraphicsDC, R2_XORPEN))
@@ -2836,6 +2885,97 @@ void change_button_text(const char *button_name, const char *new_button_text) {
 *********************************/
 #ifdef X11
 
+/* Sends the queued primitives, one request per kind. */
+static void flush_batches (void)
+{
+	if (n_batch_segments > 0)
+		XDrawSegments (display, draw_target, current_gc, batch_segments, n_batch_segments);
+	if (n_batch_rects > 0)
+		XDrawRectangles (display, draw_target, current_gc, batch_rects, n_batch_rects);
+	if (n_batch_fill_rects > 0)
+		XFillRectangles (display, draw_target, current_gc, batch_fill_rects, n_batch_fill_rects);
+	if (n_batch_arcs > 0)
+		XDrawArcs (display, draw_target, current_gc, batch_arcs, n_batch_arcs);
+	if (n_batch_fill_arcs > 0)
+		XFillArcs (display, draw_target, current_gc, batch_fill_arcs, n_batch_fill_arcs);
+	n_batch_segments = n_batch_rects = n_batch_fill_rects = 0;
+	n_batch_arcs = n_batch_fill_arcs = 0;
+}
+
+static void batch_segment (int x1, int y1, int x2, int y2)
+{
+	if (n_batch_segments == MAX_BATCH)
+		flush_batches ();
+	XSegment *seg = &batch_segments[n_batch_segments++];
+	seg->x1 = (short) x1;
+	seg->y1 = (short) y1;
+	seg->x2 = (short) x2;
+	seg->y2 = (short) y2;
+}
+
+static void batch_rect (XRectangle *batch, int *n, int xl, int yt,
+						unsigned int width, unsigned int height)
+{
+	if (*n == MAX_BATCH)
+		flush_batches ();
+	XRectangle *rect = &batch[(*n)++];
+	rect->x = (short) xl;
+	rect->y = (short) yt;
+	rect->width = (unsigned short) width;
+	rect->height = (unsigned short) height;
+}
+
+static void batch_arc (XArc *batch, int *n, int xl, int yt, unsigned int width,
+					   unsigned int height, int startang, int angextent)
+{
+	if (*n == MAX_BATCH)
+		flush_batches ();
+	XArc *arc = &batch[(*n)++];
+	arc->x = (short) xl;
+	arc->y = (short) yt;
+	arc->width = (unsigned short) width;
+	arc->height = (unsigned short) height;
+	arc->angle1 = (short) startang;
+	arc->angle2 = (short) angextent;
+}
+
+
+/* Draw into an off-screen pixmap the size of the window (made again if *
+* the window was resized) until displaybuffer or drawtoscreen.         */
+void drawtobuffer (void)
+{
+	flush_batches ();
+	if (backbuffer == None || backbuffer_width != top_width || backbuffer_height != top_height) {
+		if (backbuffer != None)
+			XFreePixmap (display, backbuffer);
+		backbuffer = XCreatePixmap (display, toplevel, top_width, top_height,
+			DefaultDepth (display, screen_num));
+		backbuffer_width = top_width;
+		backbuffer_height = top_height;
+	}
+	draw_target = backbuffer;
+}
+
+
+void drawtoscreen (void)
+{
+	flush_batches ();
+	draw_target = toplevel;
+}
+
+
+/* Copy the finished frame to the window in one request. */
+void displaybuffer (void)
+{
+	flush_batches ();
+	if (backbuffer != None) {
+		XCopyArea (display, backbuffer, toplevel, gc, 0, 0,
+			backbuffer_width, backbuffer_height, 0, 0);
+	}
+	XFlush (display);
+}
+
+
 /* Creates a small window at the top of the graphics area for text messages */
 static void build_textarea (void) 
 {
@@ -3842,13 +3982,13 @@ void enable_or_disable_button(int ibutton, bool enabled) { }
 
 void change_button_text(const char *button_text, const char *new_button_text) { }
 
-#ifdef WIN32
 void drawtobuffer(void) { }
 
 void drawtoscreen(void) { }
 
 void displaybuffer(void) { }
 
+#ifdef WIN32
 void setcolor_by_colorref (COLORREF) { }
 
 void drawcurve(t_point *points, int npoints) { }
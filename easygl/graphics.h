@@ -218,16 +218,21 @@ void change_button_text(const char *button_text, const char *new_button_text);
 void report_structure(t_report*);
 
 
+/* Double buffering: after drawtobuffer, drawing goes to an off-screen
+ * buffer that displaybuffer copies to the window in one go.  drawtoscreen
+ * goes back to drawing on the window directly.
+ */
+void drawtobuffer(void);
+void drawtoscreen(void);
+void displaybuffer(void);
+
+
 /**************** Extra functions available only in WIN32. *******/
 #ifdef WIN32
 /* VB: TODO: I should make any generally useful functions below work in
  * X11 as well, and probably delete anything else.
  */
 
-/* Added by William to provide double buffering in Windows */
-void drawtobuffer(void);
-void drawtoscreen(void);
-void displaybuffer(void);
 void setcolor_by_colorref (COLORREF);
 void drawcurve(t_point *points, int npoints);
 void fillcurve(t_point *points, int npoints);
@@ -0,0 +1,161 @@
+#include "exhaustive.h"
+#include "thread_pool.h"
+#include <climits>
+
+// the netlist flattened into arrays, indexed by position among the free
+// cells and by net label
+struct sweep_netlist {
+    std::vector<int> free_cells;        // labels, bit i of a code is free_cells[i]
+    std::vector<int> area;              // per free cell
+    std::vector<int> nets_begin;        // per free cell, into nets, plus an end
+    std::vector<int> nets;
+    std::vector<int> pins;              // per net
+    std::vector<int> fixed_right_pins;  // per net
+    std::vector<int> weight;            // per net
+    int fixed_left_area;
+    int fixed_right_area;
+    int left_capacity;
+    int right_capacity;
+};
+
+struct sweep_result {
+    int cut;
+    unsigned long long code;
+};
+
+static inline int is_cut(int right_pins, int pins) {
+    // 0 < right_pins < pins
+    return (unsigned)(right_pins - 1) < (unsigned)(pins - 1);
+}
+
+// gray codes first..last-1
+static void sweep(sweep_netlist& s, unsigned long long first, unsigned long long last, sweep_result* result) {
+    std::vector<int> right_pins = s.fixed_right_pins;
+    unsigned long long code = first ^ (first >> 1);
+    int right_area = s.fixed_right_area;
+    int total_area = s.fixed_left_area + s.fixed_right_area;
+    for (size_t i = 0; i < s.area.size(); ++i) {
+        total_area += s.area[i];
+        if ((code >> i) & 1ULL) {
+            right_area += s.area[i];
+            for (int k = s.nets_begin[i]; k < s.nets_begin[i + 1]; ++k) {
+                right_pins[s.nets[k]]++;
+            }
+        }
+    }
+    int cut = 0;
+    for (size_t n = 0; n < s.pins.size(); ++n) {
+        cut += is_cut(right_pins[n], s.pins[n])*s.weight[n];
+    }
+
+    result->cut = INT_MAX;
+    for (unsigned long long i = first; ; ) {
+        bool balanced = right_area <= s.right_capacity && total_area - right_area <= s.left_capacity;
+        if (balanced && cut < result->cut) {
+            result->cut = cut;
+            result->code = code;
+        }
+        if (++i == last) {
+            break;
+        }
+        int flip = __builtin_ctzll(i);
+        code ^= 1ULL << flip;
+        int d = ((code >> flip) & 1ULL) ? 1 : -1;
+        right_area += d*s.area[flip];
+        for (int k = s.nets_begin[flip]; k < s.nets_begin[flip + 1]; ++k) {
+            int n = s.nets[k];
+            int before = is_cut(right_pins[n], s.pins[n]);
+            right_pins[n] += d;
+            cut += (is_cut(right_pins[n], s.pins[n]) - before)*s.weight[n];
+        }
+    }
+}
+
+int a3::exhaustive_limit(int n_threads) {
+    int limit = EXHAUSTIVE_CELLS_PER_THREAD;
+    for (int t = 2; t <= n_threads && limit < EXHAUSTIVE_MAX_CELLS; t *= 2) {
+        limit++;
+    }
+    return limit;
+}
+
+a3::partition* a3::solve_exhaustive(circuit* c, int n_threads) {
+    sweep_netlist s;
+    int max_net = 0;
+    for (auto n : c->get_nets()) {
+        max_net = std::max(max_net, n->label);
+    }
+    s.pins.assign(max_net + 1, 0);
+    s.fixed_right_pins.assign(max_net + 1, 0);
+    s.weight.assign(max_net + 1, 0);
+    for (auto n : c->get_nets()) {
+        s.pins[n->label] = n->cell_labels.size;
+        s.weight[n->label] = n->weight;
+    }
+
+    s.fixed_left_area = 0;
+    s.fixed_right_area = 0;
+    bool symmetric = c->get_n_fixed() == 0 && c->get_left_capacity() == c->get_right_capacity();
+    int pinned = -1;
+    for (auto cl : c->get_cells()) {
+        if (c->get_fixed_right().get(cl->label)) {
+            s.fixed_right_area += cl->area;
+            cl->net_labels.for_each([&](int nl) { s.fixed_right_pins[nl]++; });
+        } else if (c->get_fixed_left().get(cl->label)) {
+            s.fixed_left_area += cl->area;
+        } else if (symmetric && pinned < 0) {
+            // stands in for a fixed left cell
+            pinned = cl->label;
+            s.fixed_left_area += cl->area;
+        } else {
+            s.free_cells.push_back(cl->label);
+            s.area.push_back(cl->area);
+            s.nets_begin.push_back(s.nets.size());
+            cl->net_labels.for_each([&](int nl) { s.nets.push_back(nl); });
+        }
+    }
+    s.nets_begin.push_back(s.nets.size());
+    s.left_capacity = c->get_left_capacity();
+    s.right_capacity = c->get_right_capacity();
+
+    int n_free = s.free_cells.size();
+    if (n_free > 62) {
+        spdlog::error("{} free cells are too many to sweep", n_free);
+        return nullptr;
+    }
+    unsigned long long total = 1ULL << n_free;
+
+    // a few ranges per thread, so uneven ones still balance out
+    thread_pool pool(n_threads);
+    unsigned long long n_ranges = std::min(total, (unsigned long long)pool.size()*8);
+    std::vector<sweep_result> results(n_ranges);
+    for (unsigned long long r = 0; r < n_ranges; ++r) {
+        unsigned long long first = total/n_ranges*r + std::min(r, total % n_ranges);
+        unsigned long long last = first + total/n_ranges + (r < total % n_ranges ? 1 : 0);
+        sweep_result* result = &results[r];
+        pool.submit([&s, first, last, result]() { sweep(s, first, last, result); });
+    }
+    pool.wait();
+
+    sweep_result* best = nullptr;
+    for (auto& r : results) {
+        if (r.cut != INT_MAX && (best == nullptr || r.cut < best->cut)) {
+            best = &r;
+        }
+    }
+    spdlog::info("swept {} assignments of {} free cells on {} threads", total, n_free, pool.size());
+    if (best == nullptr) {
+        return nullptr;
+    }
+
+    a3::partition* p = new a3::partition(c);
+    p->assign_fixed();
+    if (pinned >= 0) {
+        p->assign_left(c->get_cell(pinned));
+    }
+    for (int i = 0; i < n_free; ++i) {
+        p->assign(c->get_cell(s.free_cells[i]), (best->code >> i) & 1ULL);
+    }
+    assert(p->cost() == best->cut);
+    return p;
+}
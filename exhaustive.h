@@ -0,0 +1,22 @@
+#ifndef __EXHAUSTIVE_H__
+#define __EXHAUSTIVE_H__
+#include "circuit.h"
+#include "partition.h"
+
+namespace a3 {
+    // on one thread the sweep stops beating the search at about this many
+    // free cells; each doubling of the threads buys one more, up to the max
+    const int EXHAUSTIVE_CELLS_PER_THREAD = 24;
+    const int EXHAUSTIVE_MAX_CELLS = 30;
+    int exhaustive_limit(int n_threads);
+
+    // exact min cut by visiting every assignment of the free cells in gray
+    // code order, so each one differs from the last by one cell and the cut
+    // is updated from that cell's nets alone.  with mirror-image sides the
+    // first free cell stays left.  the sequence is cut into ranges that run
+    // on n_threads threads.  of equal cuts the one earliest in the sequence
+    // wins, so the answer does not depend on the thread count.
+    // nullptr if no assignment is balanced; the caller owns the result
+    a3::partition* solve_exhaustive(circuit* c, int n_threads);
+}
+#endif
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include "circuit.h"
+#include "partition.h"
+#include "exhaustive.h"
+
+// every assignment, one partition at a time
+static int slow_min_cut(circuit* c) {
+    std::vector<cell*> cells = c->get_cells();
+    int best = INT_MAX;
+    for (unsigned long long mask = 0; mask < (1ULL << cells.size()); ++mask) {
+        a3::partition p(c);
+        bool respects_fixed = true;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            bool right = (mask & (1ULL << i));
+            right ? p.assign_right(cells[i]) : p.assign_left(cells[i]);
+            if ((right && c->get_fixed_left().get(cells[i]->label)) ||
+                (!right && c->get_fixed_right().get(cells[i]->label))) {
+                respects_fixed = false;
+            }
+        }
+        if (respects_fixed && p.is_balanced()) {
+            best = std::min(best, p.cost());
+        }
+    }
+    return best;
+}
+
+TEST(Exhaustive, matches_slow_enumeration) {
+    spdlog::set_level(spdlog::level::info);
+    for (std::string f : {"weighted_test", "slices", "reducible", "clusters", "cct1"}) {
+        circuit* c = new circuit("../data/" + f);
+        a3::partition* p = a3::solve_exhaustive(c, 2);
+        ASSERT_NE(p, nullptr) << f;
+        ASSERT_TRUE(p->is_balanced()) << f;
+        ASSERT_EQ(p->unassigned_cells.size, 0) << f;
+        ASSERT_EQ(p->cost(), slow_min_cut(c)) << f;
+        delete p;
+        delete c;
+    }
+}
+
+// fixed cells, and uneven capacities, turn off the mirror symmetry
+TEST(Exhaustive, fixed_and_uneven) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* c = new circuit("../data/cct1");
+    ASSERT_TRUE(c->load_fixed("../data/cct1_fixed"));
+    a3::partition* p = a3::solve_exhaustive(c, 2);
+    ASSERT_EQ(p->cost(), slow_min_cut(c));
+    ASSERT_TRUE(p->vl_cells.get(1));
+    ASSERT_TRUE(p->vr_cells.get(5));
+    delete p;
+    delete c;
+
+    c = new circuit("../data/cct1");
+    c->set_capacities(4, 8);
+    p = a3::solve_exhaustive(c, 2);
+    ASSERT_EQ(p->cost(), slow_min_cut(c));
+    ASSERT_LE(p->vl_area, 4);
+    delete p;
+
+    // nothing fits
+    c->set_capacities(1, 1);
+    ASSERT_EQ(a3::solve_exhaustive(c, 2), nullptr);
+    delete c;
+}
+
+// the sweep as the oracle for the search, where enumerating partitions
+// one by one would be too slow
+TEST(Exhaustive, oracle_for_search) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* c = new circuit("../data/cct2");
+    a3::partition* oracle = a3::solve_exhaustive(c, 4);
+
+    a3::partition* init = new a3::partition(c);
+    init->cut_weight = c->get_total_weight() + 1;
+    a3::partition** best = &init;
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+    t->learn_nogoods = true;
+    t->run_to_completion();
+    ASSERT_EQ((*best)->cost(), oracle->cost());
+    delete t;
+    delete oracle;
+    delete c;
+}
+
+// ties go to the earliest code, so the thread count does not matter
+TEST(Exhaustive, same_answer_any_threads) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* c = new circuit("../data/cct2");
+    a3::partition* one = a3::solve_exhaustive(c, 1);
+    for (int n : {2, 3, 8}) {
+        a3::partition* p = a3::solve_exhaustive(c, n);
+        ASSERT_EQ(p->vl_cells.to_vec(), one->vl_cells.to_vec()) << n;
+        ASSERT_EQ(p->cost(), one->cost());
+        delete p;
+    }
+    delete one;
+    delete c;
+}
+
+TEST(Exhaustive, limit) {
+    ASSERT_EQ(a3::exhaustive_limit(1), a3::EXHAUSTIVE_CELLS_PER_THREAD);
+    ASSERT_EQ(a3::exhaustive_limit(2), a3::EXHAUSTIVE_CELLS_PER_THREAD + 1);
+    ASSERT_EQ(a3::exhaustive_limit(8), a3::EXHAUSTIVE_CELLS_PER_THREAD + 3);
+    ASSERT_EQ(a3::exhaustive_limit(1 << 20), a3::EXHAUSTIVE_MAX_CELLS);
+}
@@ -0,0 +1,251 @@
+#include "figure.h"
+#include <fstream>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+
+// the two formats differ in syntax and which way y points, nothing else,
+// so the figures are drawn once against this and each writer translates.
+// coordinates are points with y pointing down
+class figure_writer {
+    protected:
+        std::ofstream out;
+        double height;
+
+    public:
+        figure_writer(std::string file) : out(file), height(0) {}
+        virtual ~figure_writer() {}
+        bool ok() { return out.good(); }
+        virtual void begin(double w, double h) = 0;
+        virtual void rect(double x, double y, double w, double h, const char* fill) = 0;
+        virtual void line(double x1, double y1, double x2, double y2, const char* stroke) = 0;
+        virtual void circle(double x, double y, double r, const char* stroke) = 0;
+        virtual void text(double x, double y, std::string s, double size) = 0;
+        virtual void end() = 0;
+};
+
+class svg_writer : public figure_writer {
+    static std::string escape(std::string s) {
+        std::string r;
+        for (char ch : s) {
+            switch (ch) {
+                case '&': r += "&amp;"; break;
+                case '<': r += "&lt;"; break;
+                case '>': r += "&gt;"; break;
+                default: r += ch;
+            }
+        }
+        return r;
+    }
+
+    public:
+        svg_writer(std::string file) : figure_writer(file) {}
+        void begin(double w, double h) {
+            height = h;
+            out << "<?xml version=\"1.0\"?>\n";
+            out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << w << "\" height=\"" << h
+                << "\" viewBox=\"0 0 " << w << " " << h << "\">\n";
+            out << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+        }
+        void rect(double x, double y, double w, double h, const char* fill) {
+            out << "<rect x=\"" << x << "\" y=\"" << y << "\" width=\"" << w << "\" height=\"" << h
+                << "\" fill=\"" << fill << "\"/>\n";
+        }
+        void line(double x1, double y1, double x2, double y2, const char* stroke) {
+            out << "<line x1=\"" << x1 << "\" y1=\"" << y1 << "\" x2=\"" << x2 << "\" y2=\"" << y2
+                << "\" stroke=\"" << stroke << "\" stroke-width=\"0.5\"/>\n";
+        }
+        void circle(double x, double y, double r, const char* stroke) {
+            out << "<circle cx=\"" << x << "\" cy=\"" << y << "\" r=\"" << r
+                << "\" fill=\"none\" stroke=\"" << stroke << "\" stroke-width=\"0.5\"/>\n";
+        }
+        void text(double x, double y, std::string s, double size) {
+            out << "<text x=\"" << x << "\" y=\"" << y << "\" font-family=\"monospace\" font-size=\""
+                << size << "\">" << escape(s) << "</text>\n";
+        }
+        void end() {
+            out << "</svg>\n";
+        }
+};
+
+class ps_writer : public figure_writer {
+    static std::string escape(std::string s) {
+        std::string r;
+        for (char ch : s) {
+            if (ch == '(' || ch == ')' || ch == '\\') {
+                r += '\\';
+            }
+            r += ch;
+        }
+        return r;
+    }
+
+    std::string current;
+
+    // "#rrggbb" to "r g b setrgbcolor", when it changes
+    void color(const char* hex) {
+        if (current == hex) {
+            return;
+        }
+        current = hex;
+        unsigned rgb = 0;
+        sscanf(hex + 1, "%x", &rgb);
+        out << ((rgb >> 16) & 0xff)/255.0 << " " << ((rgb >> 8) & 0xff)/255.0 << " "
+            << (rgb & 0xff)/255.0 << " setrgbcolor\n";
+    }
+
+    public:
+        ps_writer(std::string file) : figure_writer(file) {}
+        void begin(double w, double h) {
+            height = h;
+            out << "%!PS-Adobe-3.0 EPSF-3.0\n";
+            out << "%%BoundingBox: 0 0 " << (int)ceil(w) << " " << (int)ceil(h) << "\n";
+            out << "%%EndComments\n";
+            out << "0.5 setlinewidth\n";
+        }
+        void rect(double x, double y, double w, double h, const char* fill) {
+            color(fill);
+            out << x << " " << height - y - h << " " << w << " " << h << " rectfill\n";
+        }
+        void line(double x1, double y1, double x2, double y2, const char* stroke) {
+            color(stroke);
+            out << "newpath " << x1 << " " << height - y1 << " moveto " << x2 << " " << height - y2
+                << " lineto stroke\n";
+        }
+        void circle(double x, double y, double r, const char* stroke) {
+            color(stroke);
+            out << "newpath " << x << " " << height - y << " " << r << " 0 360 arc stroke\n";
+        }
+        void text(double x, double y, std::string s, double size) {
+            color("#000000");
+            out << "/Courier findfont " << size << " scalefont setfont " << x << " " << height - y
+                << " moveto (" << escape(s) << ") show\n";
+        }
+        void end() {
+            out << "showpage\n%%EOF\n";
+        }
+};
+
+static bool ends_with(std::string s, std::string suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool a3::figure_format_ok(std::string file) {
+    return ends_with(file, ".svg") || ends_with(file, ".ps") || ends_with(file, ".eps");
+}
+
+static figure_writer* open_figure(std::string file) {
+    figure_writer* w = nullptr;
+    if (ends_with(file, ".svg")) {
+        w = new svg_writer(file);
+    } else if (ends_with(file, ".ps") || ends_with(file, ".eps")) {
+        w = new ps_writer(file);
+    } else {
+        spdlog::error("cannot tell the format of {}, use .svg, .ps or .eps", file);
+        return nullptr;
+    }
+    if (!w->ok()) {
+        spdlog::error("cannot write figure to {}", file);
+        delete w;
+        return nullptr;
+    }
+    return w;
+}
+
+// bin colours, emptiest first, as in the interactive view
+static const char* HEAT[] = {"#808080", "#1f3fbf", "#00bfbf", "#2ca02c", "#e0c000", "#d62728"};
+static const int N_HEAT = sizeof(HEAT)/sizeof(HEAT[0]);
+
+static const double MARGIN = 20.0;
+static const double TREE_WIDTH = 1024.0;
+static const double LEVEL_HEIGHT = 12.0;
+static const double BAND_HEIGHT = 8.0;
+
+bool a3::write_tree_figure(search_snapshot& s, std::string file) {
+    std::unique_ptr<figure_writer> w(open_figure(file));
+    if (!w) {
+        return false;
+    }
+    int n_levels = s.level_counts.size();
+    w->begin(TREE_WIDTH + 2*MARGIN, 3*MARGIN + n_levels*LEVEL_HEIGHT);
+    w->text(MARGIN, MARGIN, fmt::format("{} nodes, best cut {}", s.visited_nodes, s.best_cost), 10);
+
+    auto level_y = [](int level) { return 2*MARGIN + level*LEVEL_HEIGHT; };
+    unsigned most = 1;
+    for (auto n : s.density) {
+        most = std::max(most, n);
+    }
+    double bin_width = TREE_WIDTH/DENSITY_BINS;
+    for (int l = 0; l < n_levels; ++l) {
+        for (int b = 0; b < DENSITY_BINS; ++b) {
+            unsigned n = s.density[l*DENSITY_BINS + b];
+            if (n == 0) {
+                continue;
+            }
+            int heat = (int)((N_HEAT - 1)*log2(1.0 + n)/log2(1.0 + most) + 0.5);
+            w->rect(MARGIN + b*bin_width, level_y(l) - BAND_HEIGHT/2, bin_width, BAND_HEIGHT, HEAT[heat]);
+        }
+    }
+    for (auto& r : s.recent) {
+        double x = MARGIN + r.x*TREE_WIDTH;
+        if (r.level > 0) {
+            w->line(x, level_y(r.level), MARGIN + r.parent_x*TREE_WIDTH, level_y(r.level - 1), "#000000");
+        }
+        w->circle(x, level_y(r.level), 1.5, "#000000");
+    }
+    w->end();
+    return w->ok();
+}
+
+static const double CELL_WIDTH = 40.0;
+static const double CELL_HEIGHT = 10.0;
+static const double ROW_HEIGHT = 14.0;
+static const double COLUMN_GAP = 300.0;
+
+bool a3::write_partition_figure(circuit* c, a3::partition* p, std::string file) {
+    std::unique_ptr<figure_writer> w(open_figure(file));
+    if (!w) {
+        return false;
+    }
+    std::vector<int> left = p->vl_cells.to_vec();
+    std::vector<int> right = p->vr_cells.to_vec();
+    double rows = std::max(left.size(), right.size());
+    w->begin(2*MARGIN + 2*CELL_WIDTH + COLUMN_GAP, 3*MARGIN + rows*ROW_HEIGHT);
+    w->text(MARGIN, MARGIN, fmt::format("cut {}: {} | {} cells", p->cost(), left.size(), right.size()), 10);
+
+    // pin position of each cell: the inner edge of its box
+    std::vector<double> pin_x(64*BITFIELD_WORDS), pin_y(64*BITFIELD_WORDS);
+    for (int side = 0; side < 2; ++side) {
+        std::vector<int>& cells = side ? right : left;
+        double x = MARGIN + side*(CELL_WIDTH + COLUMN_GAP);
+        for (size_t i = 0; i < cells.size(); ++i) {
+            double y = 2*MARGIN + i*ROW_HEIGHT;
+            w->rect(x, y, CELL_WIDTH, CELL_HEIGHT, side ? "#ffd8a8" : "#c6dbef");
+            w->text(x + 2, y + CELL_HEIGHT - 2, std::to_string(cells[i]), 8);
+            pin_x[cells[i]] = side ? x : x + CELL_WIDTH;
+            pin_y[cells[i]] = y + CELL_HEIGHT/2;
+        }
+    }
+
+    // each net as a star from the middle of its pins
+    for (auto n : c->get_nets()) {
+        std::vector<int> pins = n->cell_labels.to_vec();
+        if (pins.empty()) {
+            continue;
+        }
+        double hx = 0, hy = 0;
+        for (auto cl : pins) {
+            hx += pin_x[cl];
+            hy += pin_y[cl];
+        }
+        hx /= pins.size();
+        hy /= pins.size();
+        const char* stroke = p->cut_nets.get(n->label) ? "#d62728" : "#a0a0a0";
+        for (auto cl : pins) {
+            w->line(hx, hy, pin_x[cl], pin_y[cl], stroke);
+        }
+    }
+    w->end();
+    return w->ok();
+}
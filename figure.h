@@ -0,0 +1,20 @@
+#ifndef __FIGURE_H__
+#define __FIGURE_H__
+#include "circuit.h"
+#include "partition.h"
+#include "snapshot.h"
+#include <string>
+
+// headless pictures of a search and its result, for when there is no
+// display.  the format follows the file name: .svg, or .ps/.eps for
+// PostScript.  both are written as they are drawn, and their size depends
+// on the depth of the tree and the size of the netlist, never on the
+// number of nodes searched
+namespace a3 {
+    bool figure_format_ok(std::string file);
+    // density bands per level plus the most recently expanded nodes
+    bool write_tree_figure(search_snapshot& s, std::string file);
+    // cells in a column per side, nets drawn to their pins, cut nets in red
+    bool write_partition_figure(circuit* c, a3::partition* p, std::string file);
+}
+#endif
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include "circuit.h"
+#include "partition.h"
+#include "snapshot.h"
+#include "figure.h"
+
+static std::string slurp(std::string file) {
+    std::ifstream in(file);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static size_t count(std::string s, std::string what) {
+    size_t n = 0;
+    for (size_t at = s.find(what); at != std::string::npos; at = s.find(what, at + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+// searches cct1 to the end, watching it with a monitor of n_recent samples
+static search_snapshot& search(circuit* c, a3::partition** best, search_monitor& m) {
+    (*best)->cut_weight = c->get_total_weight() + 1;
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    pnode* pn;
+    while ((pn = t->dfs_step()) != nullptr) {
+        m.observe(t, pn);
+    }
+    m.publish(t, true);
+    return m.latest();
+}
+
+TEST(Figure, format) {
+    ASSERT_TRUE(a3::figure_format_ok("tree.svg"));
+    ASSERT_TRUE(a3::figure_format_ok("tree.ps"));
+    ASSERT_TRUE(a3::figure_format_ok("tree.eps"));
+    ASSERT_FALSE(a3::figure_format_ok("tree.png"));
+    ASSERT_FALSE(a3::figure_format_ok("svg"));
+    circuit* c = new circuit("../data/cct1");
+    a3::partition* p = new a3::partition(c);
+    ASSERT_FALSE(a3::write_partition_figure(c, p, "partition.png"));
+    delete c;
+}
+
+// cut nets are red, one line per pin, in either format
+TEST(Figure, partition) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* c = new circuit("../data/cct1");
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    search_monitor m(c->get_n_cells() + 1, 1);
+    search(c, best, m);
+
+    size_t cut_pins = 0;
+    for (auto n : c->get_nets()) {
+        if ((*best)->cut_nets.get(n->label)) {
+            cut_pins += n->cell_labels.size;
+        }
+    }
+    ASSERT_GT(cut_pins, 0);
+
+    ASSERT_TRUE(a3::write_partition_figure(c, *best, "partition_test.svg"));
+    std::string svg = slurp("partition_test.svg");
+    ASSERT_EQ(svg.find("<?xml"), 0);
+    ASSERT_NE(svg.find("</svg>"), std::string::npos);
+    ASSERT_EQ(count(svg, "stroke=\"#d62728\""), cut_pins);
+    ASSERT_EQ(count(svg, "<line"), count(svg, "stroke=\"#d62728\"") + count(svg, "stroke=\"#a0a0a0\""));
+
+    ASSERT_TRUE(a3::write_partition_figure(c, *best, "partition_test.eps"));
+    std::string ps = slurp("partition_test.eps");
+    ASSERT_EQ(ps.find("%!PS"), 0);
+    ASSERT_NE(ps.find("showpage"), std::string::npos);
+    ASSERT_EQ(count(ps, " lineto stroke"), count(svg, "<line"));
+    delete c;
+}
+
+// the figure of a tree is as big as its depth and sample count allow,
+// however many nodes were searched
+TEST(Figure, tree) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* c = new circuit("../data/cct1");
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    search_monitor m(c->get_n_cells() + 1, 1, 16);
+    search_snapshot& s = search(c, best, m);
+    ASSERT_GT(s.visited_nodes, 16);
+
+    ASSERT_TRUE(a3::write_tree_figure(s, "tree_test.svg"));
+    std::string svg = slurp("tree_test.svg");
+    ASSERT_EQ(svg.find("<?xml"), 0);
+    ASSERT_NE(svg.find("</svg>"), std::string::npos);
+    ASSERT_EQ(count(svg, "<circle"), 16);
+    ASSERT_LE(count(svg, "<rect"), 1 + s.level_counts.size()*DENSITY_BINS);
+
+    ASSERT_TRUE(a3::write_tree_figure(s, "tree_test.ps"));
+    std::string ps = slurp("tree_test.ps");
+    ASSERT_EQ(ps.find("%!PS"), 0);
+    ASSERT_NE(ps.find("showpage"), std::string::npos);
+    ASSERT_EQ(count(ps, " arc stroke"), 16);
+    delete c;
+}
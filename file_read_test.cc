@@ -2,6 +2,7 @@
 #include <vector>
 #include <unordered_set>
 #include <utility>
+#include <fstream>
 #include "circuit.h"
 
 // Basic file read sanity checks
@@ -41,3 +42,129 @@ TEST(FileRead, cct1_conns) {
 
     delete c;
 }
+
+TEST(FileRead, weights_and_areas) {
+    circuit* c = new circuit("../data/weighted_test");
+    ASSERT_EQ(c->get_n_cells(),6);
+    ASSERT_EQ(c->get_n_nets(),6);
+    ASSERT_EQ(c->get_net(4)->weight,5);
+    ASSERT_EQ(c->get_net(1)->weight,3);
+    ASSERT_EQ(c->get_net(2)->weight,1);
+    ASSERT_EQ(c->get_cell(1)->area,2);
+    ASSERT_EQ(c->get_cell(2)->area,1);
+    ASSERT_EQ(c->get_total_area(),8);
+    ASSERT_EQ(c->get_total_weight(),12);
+    ASSERT_EQ(c->get_side_capacity(),4);
+    delete c;
+}
+
+// bad annotation values fail the load instead of throwing
+TEST(FileRead, malformed_annotations) {
+    ASSERT_TRUE(circuit("../data/weighted_test").parsed_ok());
+    for (std::string bad : {"area 1 x", "weight 1 99999999999", "area 1", "weight 9 2", "size 1 2"}) {
+        std::ofstream out("malformed_test");
+        out << "1 1 2 -1\n2 1 -1\n-1\n" << bad << "\n-1\n";
+        out.close();
+        circuit c("malformed_test");
+        ASSERT_FALSE(c.parsed_ok()) << bad;
+    }
+}
+
+// parallel nets fold into the lowest label, whatever order they come in
+TEST(FileRead, reduce_keeps_lowest_label) {
+    std::ofstream out("parallel_test");
+    out << "1 5 7 3 -1\n2 5 7 3 -1\n-1\n";
+    out.close();
+    circuit c("parallel_test");
+    c.reduce();
+    ASSERT_EQ(c.get_n_folded_nets(), 2);
+    ASSERT_EQ(c.get_net(5), nullptr);
+    ASSERT_EQ(c.get_net(7), nullptr);
+    ASSERT_EQ(c.get_net(3)->weight, 3);
+    bitfield cut;
+    cut.set(3);
+    ASSERT_EQ(c.original_nets(cut).size, 3);
+}
+
+// a fixed-cell file cannot change areas or weights behind the totals
+TEST(FileRead, fixed_file_only_fixes) {
+    circuit c("../data/cct1");
+    std::ofstream out("fixed_area_test");
+    out << "fix 1 L\narea 2 5\n";
+    out.close();
+    ASSERT_FALSE(c.load_fixed("fixed_area_test"));
+    ASSERT_EQ(c.get_cell(2)->area, 1);
+    ASSERT_EQ(c.get_total_area(), 12);
+    ASSERT_TRUE(c.load_fixed("../data/cct1_fixed"));
+    ASSERT_EQ(c.get_n_fixed(), 3);
+}
+
+TEST(FileRead, components) {
+    circuit* c = new circuit("../data/cct1");
+    ASSERT_EQ(c->get_components().size(), 1);
+    delete c;
+
+    c = new circuit("../data/clusters");
+    vector<bitfield>& comps = c->get_components();
+    ASSERT_EQ(comps.size(), 4);
+    ASSERT_EQ(comps[0].size, 5);
+    ASSERT_EQ(comps[1].size, 6);
+    ASSERT_EQ(comps[2].size, 1); // cell 12 is on no net
+    ASSERT_TRUE(comps[3].get(13));
+    ASSERT_TRUE(comps[3].get(14));
+    delete c;
+}
+
+TEST(FileRead, reduce) {
+    circuit* c = new circuit("../data/reducible");
+    ASSERT_EQ(c->get_n_nets(), 9);
+    ASSERT_EQ(c->get_total_weight(), 11);
+    c->reduce();
+
+    // nets 8 and 9 have one pin each, net 2 runs parallel to net 1
+    ASSERT_EQ(c->get_n_dropped_nets(), 2);
+    ASSERT_EQ(c->get_n_folded_nets(), 1);
+    ASSERT_EQ(c->get_n_nets(), 6);
+    ASSERT_EQ(c->get_net(2), nullptr);
+    ASSERT_EQ(c->get_net(9), nullptr);
+    ASSERT_EQ(c->get_net(1)->weight, 4);
+    ASSERT_EQ(c->get_total_weight(), 9);
+    ASSERT_FALSE(c->get_cell(1)->net_labels.get(9));
+
+    bitfield cut;
+    cut.set(1);
+    bitfield original = c->original_nets(cut);
+    ASSERT_EQ(original.size, 2);
+    ASSERT_TRUE(original.get(2));
+
+    vector<vector<int>>& groups = c->get_cell_groups();
+    ASSERT_EQ(groups.size(), 2);
+    ASSERT_EQ(groups[0], vector<int>({4, 5, 6}));
+    ASSERT_EQ(groups[1], vector<int>({8, 9}));
+    delete c;
+}
+
+TEST(FileRead, symmetries) {
+    // identical cells are found without reduce() too
+    circuit* c = new circuit("../data/reducible");
+    c->find_symmetries();
+    vector<vector<int>>& groups = c->get_cell_groups();
+    ASSERT_EQ(groups.size(), 2);
+    ASSERT_EQ(groups[0], vector<int>({4, 5, 6}));
+    ASSERT_EQ(groups[1], vector<int>({8, 9}));
+    delete c;
+
+    // three bit slices (1,2), (3,4), (5,6): no single swap works, whole
+    // slices have to move together
+    c = new circuit("../data/slices");
+    c->find_symmetries();
+    ASSERT_EQ(c->get_cell_groups().size(), 0);
+    vector<vector<int>>& autos = c->get_automorphisms();
+    ASSERT_EQ(autos.size(), 2);
+    for (auto& perm : autos) {
+        ASSERT_NE(perm[1], 1);
+        ASSERT_EQ(perm[2], perm[1] + 1);
+        ASSERT_EQ(perm[7], 7);
+    }
+    delete c;
+}
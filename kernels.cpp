@@ -0,0 +1,236 @@
+#include "kernels.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// kernels write whole words of out and leave the size to the caller's
+// recount(); count is a multiple of KERNEL_LANES and at most 64*BITFIELD_WORDS
+
+static void guaranteed_cuts_scalar(const int* free_area, int count, bitfield& within,
+        bitfield& left, bitfield& right, int room_left, int room_right, bitfield& out) {
+    int room_either = std::max(room_left, room_right);
+    for (int l = 0; l < count; ++l) {
+        int room = left.get(l) ? room_left : (right.get(l) ? room_right : room_either);
+        out.bits[l >> 6] |= (unsigned long long)(free_area[l] > room) << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+static void nonzero_scalar(const int* v, int count, bitfield& within, bitfield& out) {
+    for (int l = 0; l < count; ++l) {
+        out.bits[l >> 6] |= (unsigned long long)(v[l] != 0) << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+static void both_nonzero_scalar(const int* a, const int* b, int count, bitfield& within, bitfield& out) {
+    for (int l = 0; l < count; ++l) {
+        out.bits[l >> 6] |= (unsigned long long)(a[l] != 0 && b[l] != 0) << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+#ifdef KERNELS_X86
+
+// eight bits of a bitfield as all-ones / all-zeros lanes
+__attribute__((target("avx2")))
+static inline __m256i lanes_of(bitfield& b, int l) {
+    const __m256i bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i byte = _mm256_set1_epi32((int)((b.bits[l >> 6] >> (l & 63)) & 0xff));
+    return _mm256_cmpeq_epi32(_mm256_and_si256(byte, bit), bit);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned long long mask_of(__m256i lanes) {
+    return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lanes));
+}
+
+__attribute__((target("avx2")))
+static void guaranteed_cuts_avx2(const int* free_area, int count, bitfield& within,
+        bitfield& left, bitfield& right, int room_left, int room_right, bitfield& out) {
+    __m256i rl = _mm256_set1_epi32(room_left);
+    __m256i rr = _mm256_set1_epi32(room_right);
+    __m256i re = _mm256_set1_epi32(std::max(room_left, room_right));
+    for (int l = 0; l < count; l += 8) {
+        __m256i room = _mm256_blendv_epi8(re, rr, lanes_of(right, l));
+        room = _mm256_blendv_epi8(room, rl, lanes_of(left, l));
+        __m256i area = _mm256_loadu_si256((const __m256i*)(free_area + l));
+        out.bits[l >> 6] |= mask_of(_mm256_cmpgt_epi32(area, room)) << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+__attribute__((target("avx2")))
+static void nonzero_avx2(const int* v, int count, bitfield& within, bitfield& out) {
+    __m256i zero = _mm256_setzero_si256();
+    for (int l = 0; l < count; l += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(v + l));
+        out.bits[l >> 6] |= (~mask_of(_mm256_cmpeq_epi32(x, zero)) & 0xffULL) << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+__attribute__((target("avx2")))
+static void both_nonzero_avx2(const int* a, const int* b, int count, bitfield& within, bitfield& out) {
+    __m256i zero = _mm256_setzero_si256();
+    for (int l = 0; l < count; l += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + l));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + l));
+        __m256i either_zero = _mm256_or_si256(_mm256_cmpeq_epi32(x, zero), _mm256_cmpeq_epi32(y, zero));
+        out.bits[l >> 6] |= (~mask_of(either_zero) & 0xffULL) << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+// AVX-512 compares straight into bit masks, sixteen labels at a time
+__attribute__((target("avx512f")))
+static void guaranteed_cuts_avx512(const int* free_area, int count, bitfield& within,
+        bitfield& left, bitfield& right, int room_left, int room_right, bitfield& out) {
+    __m512i rl = _mm512_set1_epi32(room_left);
+    __m512i rr = _mm512_set1_epi32(room_right);
+    __m512i re = _mm512_set1_epi32(std::max(room_left, room_right));
+    for (int l = 0; l < count; l += 16) {
+        __mmask16 in_left = (__mmask16)(left.bits[l >> 6] >> (l & 63));
+        __mmask16 in_right = (__mmask16)(right.bits[l >> 6] >> (l & 63));
+        __m512i room = _mm512_mask_blend_epi32(in_right, re, rr);
+        room = _mm512_mask_blend_epi32(in_left, room, rl);
+        __m512i area = _mm512_loadu_si512((const void*)(free_area + l));
+        out.bits[l >> 6] |= (unsigned long long)_mm512_cmpgt_epi32_mask(area, room) << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+__attribute__((target("avx512f")))
+static void nonzero_avx512(const int* v, int count, bitfield& within, bitfield& out) {
+    for (int l = 0; l < count; l += 16) {
+        __m512i x = _mm512_loadu_si512((const void*)(v + l));
+        out.bits[l >> 6] |= (unsigned long long)_mm512_test_epi32_mask(x, x) << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+__attribute__((target("avx512f")))
+static void both_nonzero_avx512(const int* a, const int* b, int count, bitfield& within, bitfield& out) {
+    for (int l = 0; l < count; l += 16) {
+        __m512i x = _mm512_loadu_si512((const void*)(a + l));
+        __m512i y = _mm512_loadu_si512((const void*)(b + l));
+        __mmask16 k = _mm512_test_epi32_mask(x, x) & _mm512_test_epi32_mask(y, y);
+        out.bits[l >> 6] |= (unsigned long long)k << (l & 63);
+    }
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        out.bits[i] &= within.bits[i];
+    }
+}
+
+#endif
+
+struct kernel_set {
+    const char* isa;
+    void (*guaranteed_cuts)(const int*, int, bitfield&, bitfield&, bitfield&, int, int, bitfield&);
+    void (*nonzero)(const int*, int, bitfield&, bitfield&);
+    void (*both_nonzero)(const int*, const int*, int, bitfield&, bitfield&);
+};
+
+static const kernel_set SCALAR = {"scalar", guaranteed_cuts_scalar, nonzero_scalar, both_nonzero_scalar};
+#ifdef KERNELS_X86
+static const kernel_set AVX2 = {"avx2", guaranteed_cuts_avx2, nonzero_avx2, both_nonzero_avx2};
+static const kernel_set AVX512 = {"avx512", guaranteed_cuts_avx512, nonzero_avx512, both_nonzero_avx512};
+#endif
+
+static bool runs(const kernel_set& k) {
+#ifdef KERNELS_X86
+    // this also runs during static initialisation
+    __builtin_cpu_init();
+    if (&k == &AVX512) {
+        return __builtin_cpu_supports("avx512f");
+    }
+    if (&k == &AVX2) {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return &k == &SCALAR;
+}
+
+// best first
+static const kernel_set* const ALL[] = {
+#ifdef KERNELS_X86
+    &AVX512, &AVX2,
+#endif
+    &SCALAR,
+};
+
+static const kernel_set* pick_best() {
+    for (auto k : ALL) {
+        if (runs(*k)) {
+            return k;
+        }
+    }
+    return &SCALAR;
+}
+
+static const kernel_set* active = pick_best();
+
+void a3::guaranteed_cuts(const int* free_area, int count, bitfield& within,
+        bitfield& left, bitfield& right, int room_left, int room_right, bitfield& out) {
+    assert(count % KERNEL_LANES == 0 && count <= 64*BITFIELD_WORDS);
+    out = bitfield();
+    active->guaranteed_cuts(free_area, count, within, left, right, room_left, room_right, out);
+    out.recount();
+}
+
+void a3::nonzero(const int* v, int count, bitfield& within, bitfield& out) {
+    assert(count % KERNEL_LANES == 0 && count <= 64*BITFIELD_WORDS);
+    out = bitfield();
+    active->nonzero(v, count, within, out);
+    out.recount();
+}
+
+void a3::both_nonzero(const int* a, const int* b, int count, bitfield& within, bitfield& out) {
+    assert(count % KERNEL_LANES == 0 && count <= 64*BITFIELD_WORDS);
+    out = bitfield();
+    active->both_nonzero(a, b, count, within, out);
+    out.recount();
+}
+
+std::string a3::kernel_isa() {
+    return active->isa;
+}
+
+std::vector<std::string> a3::supported_kernel_isas() {
+    std::vector<std::string> ret;
+    for (auto k : ALL) {
+        if (runs(*k)) {
+            ret.push_back(k->isa);
+        }
+    }
+    return ret;
+}
+
+bool a3::set_kernel_isa(std::string isa) {
+    for (auto k : ALL) {
+        if (isa == k->isa && runs(*k)) {
+            active = k;
+            return true;
+        }
+    }
+    return false;
+}
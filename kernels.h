@@ -0,0 +1,39 @@
+#ifndef __KERNELS_H__
+#define __KERNELS_H__
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cassert>
+#include "bitfield.h"
+
+// the bound's per-label scans, over the partition's per-net and per-cell
+// arrays as they are laid out.  each has a scalar version and, on x86, AVX2
+// and AVX-512 ones; the best the cpu runs is picked when the program starts.
+// arrays are padded to KERNEL_LANES entries so the vector loops need no
+// tail, and every result is limited to the labels in `within`, which keeps
+// padding and unused labels out.  the lanes run across the labels of one
+// node; nodes are still bounded one at a time, each child as it is made
+
+const int KERNEL_LANES = 16;
+
+constexpr int kernel_padded(int n) {
+    return (n + KERNEL_LANES - 1)/KERNEL_LANES*KERNEL_LANES;
+}
+
+namespace a3 {
+    // labels whose free_area exceeds the room on the side they are anchored
+    // to: room_left if in left, else room_right if in right, else the larger
+    void guaranteed_cuts(const int* free_area, int count, bitfield& within,
+            bitfield& left, bitfield& right, int room_left, int room_right, bitfield& out);
+    // labels with v[l] != 0
+    void nonzero(const int* v, int count, bitfield& within, bitfield& out);
+    // labels with a[l] != 0 and b[l] != 0
+    void both_nonzero(const int* a, const int* b, int count, bitfield& within, bitfield& out);
+
+    // "avx512", "avx2" or "scalar"
+    std::string kernel_isa();
+    std::vector<std::string> supported_kernel_isas();
+    // false if the cpu cannot run it
+    bool set_kernel_isa(std::string isa);
+}
+#endif
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include "circuit.h"
+#include "partition.h"
+#include "kernels.h"
+
+static bitfield random_bits(int count, int percent) {
+    bitfield b;
+    for (int l = 0; l < count; ++l) {
+        if (rand() % 100 < percent) {
+            b.set(l);
+        }
+    }
+    return b;
+}
+
+// every kernel the cpu runs gives what the definitions say, label for label
+TEST(Kernels, match_definition) {
+    srand(7);
+    std::vector<std::string> isas = a3::supported_kernel_isas();
+    ASSERT_EQ(isas.back(), "scalar");
+    std::string was = a3::kernel_isa();
+    for (int trial = 0; trial < 200; ++trial) {
+        int count = kernel_padded(1 + rand() % 256);
+        std::vector<int> a(count), b(count);
+        for (int l = 0; l < count; ++l) {
+            a[l] = rand() % 3 == 0 ? 0 : rand() % 40 - 5;
+            b[l] = rand() % 3 == 0 ? 0 : rand() % 40;
+        }
+        bitfield within = random_bits(count, 80);
+        bitfield left = random_bits(count, 30);
+        bitfield right = random_bits(count, 30);
+        int room_left = rand() % 30 - 5;
+        int room_right = rand() % 30 - 5;
+
+        for (auto& isa : isas) {
+            ASSERT_TRUE(a3::set_kernel_isa(isa));
+            bitfield cuts, nz, both;
+            a3::guaranteed_cuts(a.data(), count, within, left, right, room_left, room_right, cuts);
+            a3::nonzero(a.data(), count, within, nz);
+            a3::both_nonzero(a.data(), b.data(), count, within, both);
+            bitfield want_cuts, want_nz, want_both;
+            for (int l = 0; l < count; ++l) {
+                if (!within.get(l)) {
+                    continue;
+                }
+                int room = left.get(l) ? room_left : (right.get(l) ? room_right : std::max(room_left, room_right));
+                if (a[l] > room) {
+                    want_cuts.set(l);
+                }
+                if (a[l] != 0) {
+                    want_nz.set(l);
+                }
+                if (a[l] != 0 && b[l] != 0) {
+                    want_both.set(l);
+                }
+            }
+            ASSERT_EQ(cuts.to_vec(), want_cuts.to_vec()) << isa;
+            ASSERT_EQ(cuts.size, want_cuts.size) << isa;
+            ASSERT_EQ(nz.to_vec(), want_nz.to_vec()) << isa;
+            ASSERT_EQ(nz.size, want_nz.size) << isa;
+            ASSERT_EQ(both.to_vec(), want_both.to_vec()) << isa;
+            ASSERT_EQ(both.size, want_both.size) << isa;
+        }
+    }
+    ASSERT_FALSE(a3::set_kernel_isa("sse1"));
+    ASSERT_TRUE(a3::set_kernel_isa(was));
+}
+
+// the bound, and so the search, is the same whichever kernels run it
+TEST(Kernels, same_search) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* c = new circuit("../data/cct2");
+    std::string was = a3::kernel_isa();
+    unsigned long long nodes = 0;
+    int cost = 0;
+    for (auto& isa : a3::supported_kernel_isas()) {
+        ASSERT_TRUE(a3::set_kernel_isa(isa));
+        a3::partition* p = new a3::partition(c);
+        p->cut_weight = c->get_total_weight() + 1;
+        a3::partition** best = &p;
+        traverser* t = new traverser(c, best, prune_basic_cost);
+        t->prune_symmetry = true;
+        t->run_to_completion();
+        if (nodes == 0) {
+            nodes = t->visited_nodes;
+            cost = (*best)->cost();
+        }
+        ASSERT_EQ(t->visited_nodes, nodes) << isa;
+        ASSERT_EQ((*best)->cost(), cost) << isa;
+        delete t;
+    }
+    ASSERT_TRUE(a3::set_kernel_isa(was));
+    delete c;
+}
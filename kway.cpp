@@ -0,0 +1,413 @@
+#include "kway.h"
+#include "thread_pool.h"
+#include "spdlog/spdlog.h"
+#include <math.h>
+#include <mutex>
+#include <set>
+#include <algorithm>
+#include <functional>
+
+// k-way partitioning by recursive bisection.
+//
+// each bisection is solved exactly with the usual traverser, then both
+// halves become sub-circuits of their own and are split further on a
+// thread pool.  a node covering k blocks is split k/2 : k - k/2, and each
+// side may hold that many blocks' worth of area.
+//
+// nets cut by an earlier split:
+//   cut metric - already paid for, so they are dropped from both halves
+//   km1 metric - every further split of the net costs one more, so the
+//                fragment on each side is kept
+
+// exact min-cut bisection of c under its side capacities, or the best one
+// found within node_limit nodes if that is non-zero.  greedy_start skips
+// the random restarts of the initial solution, for callers solving many
+// small bisections.
+// the caller owns the returned partition
+a3::partition* a3::bisect(circuit* c, unsigned long long node_limit, bool greedy_start) {
+    // the traverser repoints *best at its leaves, so keep our own handle
+    // on the heuristic solution to free it afterwards
+    a3::partition* init = new a3::partition(c);
+    a3::partition* incumbent = init;
+    a3::partition** best = &incumbent;
+    if (greedy_start) {
+        init->initial_solution_greedy();
+    } else {
+        init->initial_solution();
+    }
+
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+    if (node_limit == 0) {
+        t->run_to_completion();
+    } else if (!t->step(node_limit).done) {
+        spdlog::debug("bisection of {} cells stopped at {} nodes", c->get_n_cells(), node_limit);
+    }
+
+    a3::partition* result = new a3::partition(*best);
+    delete t;
+    delete init;
+
+    if (!result->is_balanced()) {
+        spdlog::warn("no balanced bisection of {} cells", c->get_n_cells());
+    }
+    return result;
+}
+
+// the most area a single block may hold.  the balance tolerance e means the
+// same as for a bisection: a block may take up to (1/k + e) of the total
+int a3::kway_block_capacity(circuit* c, int k) {
+    int total = c->get_total_area();
+    int exact = (total + k - 1)/k;
+    int tolerant = (int)floor((1.0/k + c->get_balance())*total + 1e-9);
+    return std::max(exact, tolerant);
+}
+
+// fixed sides name one of two sides, which k blocks do not have
+static bool kway_supports(circuit* c) {
+    if (c->get_n_fixed() > 0) {
+        spdlog::error("{} cells are fixed to a side, which k-way partitioning does not support", c->get_n_fixed());
+        return false;
+    }
+    return true;
+}
+
+struct kway_context {
+    thread_pool* pool;
+    a3::kway_metric metric;
+    int block_capacity;
+    a3::kway_result* result;
+    std::mutex m;
+};
+
+static void kway_split(kway_context* ctx, circuit* sub, bool owned, int k, int first_block) {
+    if (k == 1) {
+        std::unique_lock<std::mutex> lock(ctx->m);
+        for (auto c : sub->get_cells()) {
+            ctx->result->block[c->label] = first_block;
+        }
+        if (owned) {
+            delete sub;
+        }
+        return;
+    }
+
+    int k_left = k/2;
+    int k_right = k - k_left;
+    sub->set_capacities(k_left*ctx->block_capacity, k_right*ctx->block_capacity);
+
+    a3::partition* p = a3::bisect(sub);
+    spdlog::info("split {} cells into blocks {}-{} | {}-{}: cut {}",
+            sub->get_n_cells(), first_block, first_block + k_left - 1,
+            first_block + k_left, first_block + k - 1, p->cost());
+
+    bitfield keep_nets;
+    for (auto n : sub->get_nets()) {
+        if (ctx->metric == a3::METRIC_KM1 || !p->cut_nets.get(n->label)) {
+            keep_nets.set(n->label);
+        }
+    }
+    circuit* left = new circuit(sub, p->vl_cells, keep_nets);
+    circuit* right = new circuit(sub, p->vr_cells, keep_nets);
+    delete p;
+    if (owned) {
+        delete sub;
+    }
+
+    ctx->pool->submit([ctx, left, k_left, first_block]() {
+        kway_split(ctx, left, true, k_left, first_block);
+    });
+    ctx->pool->submit([ctx, right, k_right, first_block, k_left]() {
+        kway_split(ctx, right, true, k_right, first_block + k_left);
+    });
+}
+
+a3::kway_result a3::kway_partition(circuit* c, int k, a3::kway_metric metric, int n_threads) {
+    a3::kway_result r;
+    if (k < 1 || k > c->get_n_cells()) {
+        spdlog::error("cannot split {} cells into {} blocks", c->get_n_cells(), k);
+        return r;
+    }
+    if (!kway_supports(c)) {
+        return r;
+    }
+
+    thread_pool pool(n_threads);
+    kway_context ctx;
+    ctx.pool = &pool;
+    ctx.metric = metric;
+    ctx.block_capacity = kway_block_capacity(c, k);
+    ctx.result = &r;
+
+    spdlog::info("{}-way partition on {} threads, at most {} area per block", k, pool.size(), ctx.block_capacity);
+
+    pool.submit([&ctx, c, k]() {
+        kway_split(&ctx, c, false, k, 0);
+    });
+    pool.wait();
+
+    kway_evaluate(c, k, r);
+    return r;
+}
+
+void a3::kway_evaluate(circuit* c, int k, a3::kway_result& r) {
+    r.cut = 0;
+    r.km1 = 0;
+    r.block_area = std::vector<int>(k, 0);
+    for (auto cl : c->get_cells()) {
+        r.block_area[r.block[cl->label]] += cl->area;
+    }
+    for (auto n : c->get_nets()) {
+        std::set<int> spanned;
+        for (auto cl : n->cell_labels.to_vec()) {
+            spanned.insert(r.block[cl]);
+        }
+        if (spanned.size() > 1) {
+            r.cut += n->weight;
+            r.km1 += n->weight*(spanned.size() - 1);
+        }
+    }
+}
+
+/****
+*
+* direct k-way branch and bound
+*
+* cells are branched on in the traverser's order (most nets first), into
+* each block with room.  block labels are interchangeable, so a cell may
+* only open the lowest numbered empty block.
+*
+****/
+
+a3::kpartition::kpartition(circuit* c, int _k, a3::kway_metric _metric) {
+    circ = c;
+    k = _k;
+    metric = _metric;
+    block_cells = std::vector<bitfield>(k);
+    block_nets = std::vector<bitfield>(k);
+    block_area = std::vector<int>(k, 0);
+    int max_label = 0;
+    for (auto n : c->get_nets()) {
+        max_label = std::max(max_label, n->label);
+    }
+    span = std::vector<int>(max_label + 1, 0);
+    for (auto cl : c->get_cells()) {
+        unassigned_cells.set(cl->label);
+    }
+    cut_weight = 0;
+    used_blocks = 0;
+}
+
+// what putting c in block b would add to the cost
+int a3::kpartition::added_cost(cell* c, int b) {
+    int added = 0;
+    for (auto nl : c->net_labels.to_vec()) {
+        if (block_nets[b].get(nl)) {
+            continue;
+        }
+        int s = span[nl];
+        if ((metric == a3::METRIC_CUT && s == 1) || (metric == a3::METRIC_KM1 && s >= 1)) {
+            added += circ->get_net(nl)->weight;
+        }
+    }
+    return added;
+}
+
+void a3::kpartition::assign(cell* c, int b) {
+    cut_weight += added_cost(c, b);
+    for (auto nl : c->net_labels.to_vec()) {
+        if (!block_nets[b].get(nl)) {
+            block_nets[b].set(nl);
+            span[nl]++;
+        }
+    }
+    unassigned_cells.clear(c->label);
+    block_cells[b].set(c->label);
+    block_area[b] += c->area;
+    used_blocks = std::max(used_blocks, b + 1);
+}
+
+// k-way versions of the two sided bounds:
+//  guaranteed - the unassigned area on a net doesn't fit in the blocks it
+//               already touches, so it has to spread into more of them
+//  anchored   - the cheapest block an unassigned cell could still go to
+int a3::kpartition::lb(int block_capacity) {
+    std::vector<int> room(k);
+    for (int b = 0; b < k; ++b) {
+        room[b] = block_capacity - block_area[b];
+    }
+
+    std::map<int,int> net_area;
+    for (auto cl : unassigned_cells.to_vec()) {
+        cell* c = circ->get_cell(cl);
+        for (auto nl : c->net_labels.to_vec()) {
+            net_area[nl] += c->area;
+        }
+    }
+
+    int guaranteed = 0;
+    bitfield counted;
+    for (auto& it : net_area) {
+        int nl = it.first;
+        int u = it.second;
+        int s = span[nl];
+        if (metric == a3::METRIC_CUT && s >= 2) {
+            continue;   // already paid for
+        }
+
+        // fill the blocks the net already touches first, then the
+        // roomiest of the rest, counting how many new blocks it takes
+        int have = 0;
+        std::vector<int> others;
+        for (int b = 0; b < k; ++b) {
+            if (block_nets[b].get(nl)) {
+                have += std::max(room[b], 0);
+            } else {
+                others.push_back(std::max(room[b], 0));
+            }
+        }
+        std::sort(others.begin(), others.end(), std::greater<int>());
+        int extra = 0;
+        for (size_t i = 0; have < u && i < others.size(); ++i) {
+            have += others[i];
+            extra++;
+        }
+
+        // a net touching nothing yet gets its first block for free
+        int new_span = s + extra;
+        int added = 0;
+        if (metric == a3::METRIC_CUT) {
+            added = (new_span >= 2) ? 1 : 0;
+        } else {
+            added = std::max(new_span, 1) - std::max(s, 1);
+        }
+        if (added > 0) {
+            guaranteed += added*circ->get_net(nl)->weight;
+            counted.set(nl);
+        }
+    }
+
+    int anchored = 0;
+    for (auto cl : unassigned_cells.to_vec()) {
+        cell* c = circ->get_cell(cl);
+        int cheapest = INT_MAX;
+        for (int b = 0; b < k; ++b) {
+            if (c->area > room[b]) {
+                continue;
+            }
+            int added = 0;
+            for (auto nl : c->net_labels.to_vec()) {
+                if (counted.get(nl) || block_nets[b].get(nl)) {
+                    continue;
+                }
+                int s = span[nl];
+                if ((metric == a3::METRIC_CUT && s == 1) || (metric == a3::METRIC_KM1 && s >= 1)) {
+                    added += circ->get_net(nl)->weight;
+                }
+            }
+            cheapest = std::min(cheapest, added);
+        }
+        if (cheapest != INT_MAX) {
+            anchored = std::max(anchored, cheapest);
+        }
+    }
+
+    return cut_weight + guaranteed + anchored;
+}
+
+struct kway_search {
+    std::vector<cell*> cells;
+    int block_capacity;
+    int best_cost;
+    a3::kpartition* best;
+    unsigned long long visited_nodes;
+};
+
+static void kway_branch(kway_search& s, a3::kpartition& p, size_t level) {
+    s.visited_nodes++;
+    if (level == s.cells.size()) {
+        if (p.cost() < s.best_cost) {
+            spdlog::info("found new best! ({} < {})", p.cost(), s.best_cost);
+            s.best_cost = p.cost();
+            *s.best = p;
+        }
+        return;
+    }
+
+    cell* c = s.cells[level];
+    int n_open = std::min(p.used_blocks + 1, p.k);
+
+    // cheapest blocks first, so good incumbents turn up early
+    std::vector<std::pair<int,int>> order;
+    for (int b = 0; b < n_open; ++b) {
+        if (p.block_area[b] + c->area <= s.block_capacity) {
+            order.push_back(std::make_pair(p.added_cost(c, b), b));
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    for (auto& it : order) {
+        if (p.cost() + it.first >= s.best_cost) {
+            break;
+        }
+        a3::kpartition child = p;
+        child.assign(c, it.second);
+        if (child.lb(s.block_capacity) >= s.best_cost) {
+            continue;
+        }
+        kway_branch(s, child, level + 1);
+    }
+}
+
+// proven optimal k-way partition. initial, e.g. from kway_partition, seeds
+// the incumbent if it is given and balanced
+a3::kway_result a3::kway_exact(circuit* c, int k, a3::kway_metric metric, a3::kway_result* initial) {
+    a3::kway_result r;
+    if (k < 1 || k > c->get_n_cells()) {
+        spdlog::error("cannot split {} cells into {} blocks", c->get_n_cells(), k);
+        return r;
+    }
+    if (!kway_supports(c)) {
+        return r;
+    }
+
+    kway_search s;
+    s.cells = c->get_cells();
+    std::sort(s.cells.begin(), s.cells.end(), cell_sort_most_nets);
+    s.block_capacity = kway_block_capacity(c, k);
+    s.best_cost = INT_MAX;
+    s.visited_nodes = 0;
+
+    a3::kpartition best(c, k, metric);
+    s.best = &best;
+
+    if (initial != nullptr && !initial->block.empty()) {
+        bool balanced = true;
+        for (auto a : initial->block_area) {
+            balanced = balanced && (a <= s.block_capacity);
+        }
+        if (balanced) {
+            for (auto cl : s.cells) {
+                best.assign(cl, initial->block[cl->label]);
+            }
+            s.best_cost = best.cost();
+            spdlog::info("Initial {}-way cost: {}", k, s.best_cost);
+        }
+    }
+
+    a3::kpartition root(c, k, metric);
+    kway_branch(s, root, 0);
+    spdlog::info("Visited nodes: {}", s.visited_nodes);
+
+    if (best.unassigned_cells.size != 0) {
+        spdlog::error("no balanced {}-way partition exists", k);
+        return r;
+    }
+    for (int b = 0; b < k; ++b) {
+        for (auto cl : best.block_cells[b].to_vec()) {
+            r.block[cl] = b;
+        }
+    }
+    kway_evaluate(c, k, r);
+    return r;
+}
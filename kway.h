@@ -0,0 +1,49 @@
+#ifndef __KWAY_H__
+#define __KWAY_H__
+#include "circuit.h"
+#include "partition.h"
+#include <map>
+#include <vector>
+
+namespace a3 {
+    // what a k-way partition is scored on
+    enum kway_metric {
+        METRIC_CUT,     // weight of nets spanning more than one block
+        METRIC_KM1      // sum of weight*(blocks spanned - 1), aka connectivity-1
+    };
+
+    struct kway_result {
+        std::map<int,int> block;        // cell label -> block
+        std::vector<int> block_area;
+        int cut;
+        int km1;
+    };
+
+    // search state for the direct k-way branch and bound: the two sided
+    // partition generalised to k blocks
+    struct kpartition {
+        circuit* circ;
+        int k;
+        kway_metric metric;
+        std::vector<bitfield> block_cells;
+        std::vector<bitfield> block_nets;
+        std::vector<int> block_area;
+        std::vector<int> span;          // net label -> number of blocks it touches
+        bitfield unassigned_cells;
+        int cut_weight;
+        int used_blocks;
+
+        kpartition(circuit* c, int k, kway_metric metric);
+        int cost() { return cut_weight; }
+        int added_cost(cell* c, int b);
+        void assign(cell* c, int b);
+        int lb(int block_capacity);
+    };
+
+    a3::partition* bisect(circuit* c, unsigned long long node_limit = 0, bool greedy_start = false);
+    int kway_block_capacity(circuit* c, int k);
+    kway_result kway_partition(circuit* c, int k, kway_metric metric, int n_threads);
+    void kway_evaluate(circuit* c, int k, kway_result& r);
+    kway_result kway_exact(circuit* c, int k, kway_metric metric, kway_result* initial);
+}
+#endif
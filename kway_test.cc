@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <set>
+#include <climits>
+#include "circuit.h"
+#include "partition.h"
+#include "kway.h"
+
+TEST(Kway, subcircuit) {
+    circuit* c = new circuit("../data/partition_test");
+    bitfield cells, nets;
+    cells.set(2);
+    cells.set(3);
+    nets.set(1);
+    nets.set(2);
+    nets.set(3);
+    circuit* sub = new circuit(c, cells, nets);
+
+    ASSERT_EQ(sub->get_n_cells(), 2);
+    ASSERT_EQ(sub->get_n_nets(), 3);
+    ASSERT_TRUE(sub->get_net(2)->cell_labels.get(2));
+    ASSERT_TRUE(sub->get_net(2)->cell_labels.get(3));
+    ASSERT_FALSE(sub->get_net(1)->cell_labels.get(1));
+    ASSERT_EQ(sub->get_net(4), nullptr);
+
+    delete sub;
+    delete c;
+}
+
+TEST(Kway, four_way_cct1) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+
+    a3::kway_result r = a3::kway_partition(c, 4, a3::METRIC_CUT, 4);
+    ASSERT_EQ(r.block.size(), 12);
+    ASSERT_EQ(r.block_area.size(), 4);
+    for (auto a : r.block_area) {
+        ASSERT_EQ(a, 3);
+    }
+    ASSERT_GT(r.cut, 0);
+    ASSERT_GE(r.km1, r.cut);
+
+    // a bisection of the same circuit can only be cheaper
+    a3::partition* p = a3::bisect(c);
+    ASSERT_LE(p->cost(), r.cut);
+
+    delete p;
+    delete c;
+}
+
+// L and R mean nothing among k blocks, so fixed cells are refused rather
+// than silently placed anywhere
+TEST(Kway, fixed_cells_rejected) {
+    circuit* c = new circuit("../data/cct1");
+    ASSERT_TRUE(c->load_fixed("../data/cct1_fixed"));
+    ASSERT_TRUE(a3::kway_partition(c, 3, a3::METRIC_CUT, 2).block.empty());
+    ASSERT_TRUE(a3::kway_exact(c, 3, a3::METRIC_CUT, nullptr).block.empty());
+    delete c;
+}
+
+TEST(Kway, uneven_blocks) {
+    circuit* c = new circuit("../data/cct1");
+    a3::kway_result r = a3::kway_partition(c, 3, a3::METRIC_KM1, 2);
+    std::set<int> used;
+    for (auto& it : r.block) {
+        used.insert(it.second);
+    }
+    ASSERT_EQ(used.size(), 3);
+    for (auto a : r.block_area) {
+        ASSERT_LE(a, a3::kway_block_capacity(c, 3));
+    }
+    delete c;
+}
+
+// cheapest balanced k-way cost by trying every assignment
+int brute_force_kway(circuit* c, int k, a3::kway_metric metric) {
+    std::vector<cell*> cells = c->get_cells();
+    int cap = a3::kway_block_capacity(c, k);
+    std::vector<int> digits(cells.size(), 0);
+    int best = INT_MAX;
+    while (true) {
+        a3::kway_result r;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            r.block[cells[i]->label] = digits[i];
+        }
+        a3::kway_evaluate(c, k, r);
+        bool balanced = true;
+        for (auto a : r.block_area) {
+            balanced = balanced && a <= cap;
+        }
+        if (balanced) {
+            best = std::min(best, metric == a3::METRIC_CUT ? r.cut : r.km1);
+        }
+
+        size_t i = 0;
+        while (i < digits.size() && ++digits[i] == k) {
+            digits[i++] = 0;
+        }
+        if (i == digits.size()) {
+            break;
+        }
+    }
+    return best;
+}
+
+TEST(Kway, exact_matches_brute_force) {
+    circuit* c = new circuit("../data/weighted_test");
+    spdlog::set_level(spdlog::level::info);
+    for (auto metric : {a3::METRIC_CUT, a3::METRIC_KM1}) {
+        a3::kway_result r = a3::kway_exact(c, 3, metric, nullptr);
+        ASSERT_EQ(r.block.size(), 6);
+        int cost = (metric == a3::METRIC_CUT) ? r.cut : r.km1;
+        ASSERT_EQ(cost, brute_force_kway(c, 3, metric));
+    }
+    delete c;
+}
+
+TEST(Kway, exact_beats_recursive_bisection) {
+    circuit* c = new circuit("../data/cct1");
+    a3::kway_result rb = a3::kway_partition(c, 3, a3::METRIC_KM1, 1);
+    a3::kway_result r = a3::kway_exact(c, 3, a3::METRIC_KM1, &rb);
+    ASSERT_EQ(r.block.size(), 12);
+    ASSERT_LE(r.km1, rb.km1);
+    for (auto a : r.block_area) {
+        ASSERT_LE(a, a3::kway_block_capacity(c, 3));
+    }
+    ASSERT_EQ(r.km1, brute_force_kway(c, 3, a3::METRIC_KM1));
+    delete c;
+}
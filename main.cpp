@@ -5,6 +5,8 @@
 #include <getopt.h>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include "spdlog/spdlog.h"
 #include "version.h"
 #include "easygl/graphics.h"
@@ -12,17 +14,61 @@
 #include "circuit.h"
 #include "partition.h"
 #include "bitfield.h"
+#include "kway.h"
+#include "placement.h"
+#include "components.h"
+#include "figure.h"
+#include "kernels.h"
+#include "exhaustive.h"
+#include "snapshot.h"
+#include <thread>
 
 using namespace std;
 
 void print_usage() {
-    cout << "Usage: ./a3 -[hvfdi] -f circuit_file" << endl;
+    cout << "Usage: ./a3 -[hvfdibcrkt] -f circuit_file" << endl;
     cout << "\t-h: this help message" <<endl;
     cout << "\t-v: print version info" <<endl;
     cout << "\t-f circuit_file: the circuit file (required)" <<endl;
     cout << "\t-d: turn on debug log level" <<endl;
     cout << "\t-i: enable interactive (gui) mode" <<endl;
     cout << "\t-b: use bfs mode (youd better have a lot of RAM for cct3/4.....)" <<endl;
+    cout << "\t--ida: iterative deepening on the lower bound (low memory)" <<endl;
+    cout << "\t--tt-mb n: with --ida, memory for remembered completion bounds in MB (default 64, 0 turns it off)" <<endl;
+    cout << "\t--ties lifo|fifo|deepest: order of equal cost nodes in the default search (default deepest)" <<endl;
+    cout << "\t--nogoods n: remember up to n learned failures (default 100000, 0 turns learning off)" <<endl;
+    cout << "\t--balance e: allow each side up to (0.5+e) of the total area, e.g. 0.05 for 45/55" <<endl;
+    cout << "\t--fixed file: pin cells to a side, one 'fix <cell> <L|R>' per line" <<endl;
+    cout << "\t--no-reduce: keep single-pin and parallel nets as given" <<endl;
+    cout << "\t-k, --kway k: split into k blocks by recursive bisection" <<endl;
+    cout << "\t--exact: with -k, prove the k-way optimum by direct branch and bound" <<endl;
+    cout << "\t--metric cut|km1: k-way objective, cut nets or connectivity-1 (default cut)" <<endl;
+    cout << "\t-t, --threads n: worker threads for k-way subproblems, placement regions and components (default: all cores)" <<endl;
+    cout << "\t--place file: min-cut placement on a grid, written as 'cell x y' lines" <<endl;
+    cout << "\t--grid CxR: placement grid size (default: square, one slot per unit of area)" <<endl;
+    cout << "\t--node-limit n: nodes per placement bisection before taking the best found (default 0: exact)" <<endl;
+    cout << "\t--exhaustive-max n: sweep every assignment instead of searching up to n free cells (default: 24, one more per doubling of threads, at most 30; 0: never)" <<endl;
+    cout << "\t--export-tree file: draw the searched tree to file (.svg, .ps or .eps), no display needed" <<endl;
+    cout << "\t--export-partition file: draw the final partition and its cut nets to file" <<endl;
+    cout << "\t-c, --checkpoint file: periodically save the search frontier to file" <<endl;
+    cout << "\t--checkpoint-every seconds: checkpoint period (default 300)" <<endl;
+    cout << "\t-r, --resume file: continue a search from a checkpoint" <<endl;
+}
+
+static string checkpoint_file = "";
+static int checkpoint_period_s = 300;
+
+// called between batches of steps, not per node
+void maybe_checkpoint(traverser* t) {
+    static auto last = std::chrono::steady_clock::now();
+    if (checkpoint_file == "") {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration_cast<std::chrono::seconds>(now - last).count() >= checkpoint_period_s) {
+        t->save_checkpoint(checkpoint_file);
+        last = now;
+    }
 }
 
 void print_version() {
@@ -32,27 +78,67 @@ void print_version() {
     spdlog::info("Built {}" , __TIMESTAMP__);
 }
 
-pnode* run(circuit* c, traverser* t) {
-    static vector<int> seen;
-    pnode* pn = t->bfs ? t->bfs_step() : t->dfs_step();
-    if (pn != nullptr) {
-        if (std::find(seen.begin(), seen.end(), pn->level) == seen.end()) {
-            seen.push_back(pn->level); 
-            spdlog::info("at level {}/{}.  Visited nodes: {}", seen.size(), c->get_n_cells(), t->visited_nodes);
-        }
+// in the labels of the input file, whatever the reduction folded together
+void print_cut_nets(circuit* c, a3::partition* p) {
+    std::ostringstream os;
+    for (auto nl : c->original_nets(p->cut_nets).to_vec()) {
+        os << nl << ", ";
     }
-    return pn;
+    spdlog::info("cut nets: {}", os.str());
 }
 
 int main(int n, char** args) {
     string file = "";
 
+    string resume_file = "";
+    string fixed_file = "";
+
     bool interactive = false;
     bool bfs = false;
+    bool ida = false;
+    double balance = 0.0;
+    bool reduce = true;
+    size_t nogood_limit = 100000;
+    size_t tt_megabytes = 64;
+    bool tt_given = false;
+    tie_break ties = TIES_DEEPEST;
+    int kway = 0;
+    bool kway_exact = false;
+    a3::kway_metric metric = a3::METRIC_CUT;
+    int n_threads = std::thread::hardware_concurrency();
+    string place_file = "";
+    a3::placement_options place_opt = {0, 0, 0, 0};
+    int exhaustive_max = -1;
+    string export_tree = "";
+    string export_partition = "";
+
+    static struct option long_options[] = {
+        {"checkpoint", required_argument, 0, 'c'},
+        {"checkpoint-every", required_argument, 0, 'C'},
+        {"resume", required_argument, 0, 'r'},
+        {"ida", no_argument, 0, 'I'},
+        {"balance", required_argument, 0, 'B'},
+        {"fixed", required_argument, 0, 'F'},
+        {"no-reduce", no_argument, 0, 'R'},
+        {"nogoods", required_argument, 0, 'L'},
+        {"tt-mb", required_argument, 0, 'T'},
+        {"ties", required_argument, 0, 'Y'},
+        {"kway", required_argument, 0, 'k'},
+        {"metric", required_argument, 0, 'M'},
+        {"exact", no_argument, 0, 'E'},
+        {"threads", required_argument, 0, 't'},
+        {"place", required_argument, 0, 'P'},
+        {"grid", required_argument, 0, 'G'},
+        {"node-limit", required_argument, 0, 'N'},
+        {"exhaustive-max", required_argument, 0, 'S'},
+        {"export-tree", required_argument, 0, 'X'},
+        {"export-partition", required_argument, 0, 'W'},
+        {0, 0, 0, 0}
+    };
 
     for(;;)
     {
-        switch(getopt(n, args, "vhf:dib"))
+        switch(getopt_long(n, args, "vhf:dibc:r:k:t:", long_options, nullptr))
         {
             case 'f':
                 file = optarg;
@@ -74,6 +160,111 @@ int main(int n, char** args) {
             case 'i':
                 interactive = true;
                 continue;
+
+            case 'I':
+                ida = true;
+                continue;
+
+            case 'B':
+                balance = stod(optarg);
+                continue;
+
+            case 'F':
+                fixed_file = optarg;
+                continue;
+
+            case 'R':
+                reduce = false;
+                continue;
+
+            case 'L':
+                nogood_limit = stoul(optarg);
+                continue;
+
+            case 'T':
+                tt_megabytes = stoul(optarg);
+                tt_given = true;
+                continue;
+
+            case 'Y':
+                if (!parse_tie_break(optarg, ties)) {
+                    spdlog::error("unknown tie break {}", optarg);
+                    print_usage();
+                    return 1;
+                }
+                continue;
+
+            case 'k':
+                kway = stoi(optarg);
+                continue;
+
+            case 'M':
+                if (string(optarg) == "km1") {
+                    metric = a3::METRIC_KM1;
+                } else if (string(optarg) == "cut") {
+                    metric = a3::METRIC_CUT;
+                } else {
+                    spdlog::error("unknown metric {}", optarg);
+                    print_usage();
+                    return 1;
+                }
+                continue;
+
+            case 'E':
+                kway_exact = true;
+                continue;
+
+            case 't':
+                n_threads = stoi(optarg);
+                continue;
+
+            case 'P':
+                place_file = optarg;
+                continue;
+
+            case 'G':
+                if (sscanf(optarg, "%dx%d", &place_opt.cols, &place_opt.rows) != 2) {
+                    spdlog::error("grid must look like 8x6, not {}", optarg);
+                    return 1;
+                }
+                continue;
+
+            case 'N':
+                place_opt.node_limit = stoull(optarg);
+                continue;
+
+            case 'S':
+                exhaustive_max = stoi(optarg);
+                continue;
+
+            case 'X':
+                export_tree = optarg;
+                if (!a3::figure_format_ok(export_tree)) {
+                    spdlog::error("{}: figures are written as .svg, .ps or .eps", optarg);
+                    return 1;
+                }
+                continue;
+
+            case 'W':
+                export_partition = optarg;
+                if (!a3::figure_format_ok(export_partition)) {
+                    spdlog::error("{}: figures are written as .svg, .ps or .eps", optarg);
+                    return 1;
+                }
+                continue;
+
+            case 'c':
+                checkpoint_file = optarg;
+                continue;
+
+            case 'C':
+                checkpoint_period_s = stoi(optarg);
+                continue;
+
+            case 'r':
+                resume_file = optarg;
+                continue;
+
             case '?':
             case 'h':
             default :
@@ -95,35 +286,177 @@ int main(int n, char** args) {
     }
 
     circuit* circ = new circuit(file);
+    if (!circ->parsed_ok()) {
+        return 1;
+    }
+    if (fixed_file != "" && !circ->load_fixed(fixed_file)) {
+        return 1;
+    }
+    if (reduce) {
+        circ->reduce();
+        spdlog::info("Reduced netlist: dropped {} single-pin nets, folded {} parallel nets",
+                circ->get_n_dropped_nets(), circ->get_n_folded_nets());
+    }
+    circ->find_symmetries();
+    spdlog::info("Symmetry: {} orbits of interchangeable cells, {} further automorphisms",
+            circ->get_cell_groups().size(), circ->get_automorphisms().size());
+    if (circ->get_n_fixed() > 0) {
+        spdlog::info("{} cells fixed left, {} fixed right", circ->get_fixed_left().size, circ->get_fixed_right().size);
+    }
+    if (balance != 0.0) {
+        if (!circ->set_balance(balance)) {
+            return 1;
+        }
+        spdlog::info("Balance tolerance {}: at most {} of {} area per side", circ->get_balance(), circ->get_side_capacity(), circ->get_total_area());
+    }
+
+    if (place_file != "") {
+        place_opt.n_threads = n_threads;
+        a3::place(circ, place_opt);
+        bool ok = a3::write_placement(circ, place_file, place_opt.cols, place_opt.rows);
+        delete circ;
+        return ok ? 0 : 1;
+    }
+
+    if (kway > 0) {
+        a3::kway_result r = a3::kway_partition(circ, kway, metric, n_threads);
+        if (kway_exact && !r.block.empty()) {
+            spdlog::info("Recursive bisection cut: {}, connectivity-1: {}", r.cut, r.km1);
+            r = a3::kway_exact(circ, kway, metric, &r);
+        }
+        if (r.block.empty()) {
+            return 1;
+        }
+        for (int b = 0; b < kway; ++b) {
+            std::ostringstream os;
+            for (auto& it : r.block) {
+                if (it.second == b) {
+                    os << it.first << ", ";
+                }
+            }
+            spdlog::info("block {} (area {}): {}", b, r.block_area[b], os.str());
+        }
+        spdlog::info("Final {}-way cut: {}, connectivity-1: {}", kway, r.cut, r.km1);
+        delete circ;
+        return 0;
+    }
+
+    // small netlists are swept rather than searched, and independent
+    // clusters are solved one by one rather than in one tree, unless the
+    // tree itself or a particular way of searching it is wanted
+    bool need_tree = resume_file != "" || interactive || export_tree != "";
+    bool need_search = need_tree || checkpoint_file != "" || bfs || ida;
+    if (exhaustive_max < 0) {
+        exhaustive_max = a3::exhaustive_limit(n_threads);
+    }
+    a3::partition* p = nullptr;
+    if (!need_search && circ->get_n_cells() - circ->get_n_fixed() <= exhaustive_max) {
+        spdlog::info("Sweeping all assignments of {} free cells", circ->get_n_cells() - circ->get_n_fixed());
+        p = a3::solve_exhaustive(circ, n_threads);
+        if (p == nullptr) {
+            spdlog::error("no balanced bisection");
+            return 1;
+        }
+    } else if (!need_search && circ->get_components().size() > 1) {
+        p = a3::solve_by_components(circ, n_threads);
+        if (p == nullptr) {
+            return 1;
+        }
+    }
+    if (p != nullptr) {
+        spdlog::info("Final solution cost: {}", p->cost());
+        spdlog::info("best {}", p->to_string());
+        print_cut_nets(circ, p);
+        if (export_partition != "" && !a3::write_partition_figure(circ, p, export_partition)) {
+            return 1;
+        }
+        delete p;
+        delete circ;
+        return 0;
+    }
 
     a3::partition* init = new a3::partition(circ); 
     a3::partition** best = &init;
-    spdlog::info("Building initial solution");
-    init->initial_solution();
-    spdlog::info("Initial solution cost: {}", (*best)->cost());
-    spdlog::info("init {}", init->to_string());
-    spdlog::info("MAX COST: {}", circ->get_n_nets());
+    if (resume_file == "") {
+        spdlog::info("Building initial solution");
+        init->initial_solution();
+        spdlog::info("Initial solution cost: {}", (*best)->cost());
+        spdlog::info("init {}", init->to_string());
+    }
+    spdlog::info("MAX COST: {}", circ->get_total_weight());
 
-    spdlog::info("Traversal mode: {}", bfs ? "BFS" : "Lowest Bound");
-    
     traverser* trav = new traverser(circ, best, prune_basic_cost);
     trav->bfs = bfs;
+    trav->ida = ida;
     trav->prune_imbalance  = true;
     trav->prune_lb = true;
     trav->prune_symmetry = true;
+    trav->learn_nogoods = nogood_limit > 0;
+    trav->nogood_limit = nogood_limit;
+    trav->tt_megabytes = tt_megabytes;
+    trav->set_ties(ties);
+    trav->log_progress = true;
+
+    if (resume_file != "") {
+        spdlog::info("Resuming from {}", resume_file);
+        if (!trav->load_checkpoint(resume_file)) {
+            return 1;
+        }
+    }
+
+    spdlog::info("Traversal mode: {}", trav->ida ? "Iterative Deepening" : (trav->bfs ? "BFS" : "Lowest Bound"));
+    spdlog::info("Bound kernels: {}", a3::kernel_isa());
+    if (tt_given && !trav->ida) {
+        spdlog::warn("--tt-mb is for --ida runs, ignoring it");
+    }
     spdlog::info("Traversing decision tree");
 
     if (interactive) {
+        if (export_tree != "") {
+            spdlog::warn("--export-tree is for runs without a display, ignoring it");
+            export_tree = "";
+        }
         spdlog::info("Entering interactive mode");
-        ui_init(circ, trav, run);
+        ui_init(circ, trav, maybe_checkpoint);
+    } else if (export_tree != "") {
+        // the figure is drawn from aggregates, so memory stays bounded
+        search_monitor monitor(circ->get_n_cells() + 1, 1);
+        auto observe = [&monitor, trav](pnode* pn) { monitor.observe(trav, pn); };
+        while (!trav->step(STEP_BATCH_NODES, observe).done) {
+            maybe_checkpoint(trav);
+        }
+        monitor.publish(trav, true);
+        if (!a3::write_tree_figure(monitor.latest(), export_tree)) {
+            return 1;
+        }
     } else {
-        while (run(circ,trav) != nullptr) {}
+        if (checkpoint_file == "") {
+            trav->run_to_completion();
+        } else {
+            auto period = std::chrono::seconds(checkpoint_period_s);
+            while (!trav->run_until(std::chrono::steady_clock::now() + period).done) {
+                trav->save_checkpoint(checkpoint_file);
+            }
+            // leave an empty frontier behind so a stale resume is harmless
+            trav->save_checkpoint(checkpoint_file);
+        }
     }
 
-    spdlog::info("Final solution cost: {} @ {}", (*best)->cut_nets.size, (void*)*best);
+    spdlog::info("Final solution cost: {} @ {}", (*best)->cost(), (void*)*best);
     spdlog::info("best {}", (*best)->to_string());
-    unsigned long long int total_possible_nodes = (2<<(circ->get_n_cells()-1))-1;
-    spdlog::info("Visited/possible nodes: {}/{}", trav->visited_nodes, total_possible_nodes);
+    print_cut_nets(circ, *best);
+    if (export_partition != "" && !a3::write_partition_figure(circ, *best, export_partition)) {
+        return 1;
+    }
+    // a full tree has 2^(n+1)-1 nodes, past 64 bits for big netlists
+    double total_possible_nodes = ldexp(1.0, circ->get_n_cells() + 1) - 1;
+    spdlog::info("Visited/possible nodes: {}/{:.3g}", trav->visited_nodes, total_possible_nodes);
+    if (trav->get_nogoods() != nullptr) {
+        spdlog::info("Nogoods learned: {}, used: {}", trav->get_nogoods()->added, trav->get_nogoods()->hits);
+    }
+    if (trav->get_tt() != nullptr) {
+        spdlog::info("Transposition table: {} states, {} hits", trav->get_tt()->size(), trav->get_tt()->hits);
+    }
     
 
     if (interactive) {
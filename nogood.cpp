@@ -0,0 +1,49 @@
+#include "nogood.h"
+
+static bool subset_of(bitfield& a, bitfield& b) {
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        if ((a.bits[i] & ~b.bits[i]) != 0ULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+nogood_store::nogood_store(size_t capacity) {
+    slots = std::vector<nogood>(capacity < 1 ? 1 : capacity);
+    stamps = std::vector<unsigned long long>(slots.size(), 0);
+    by_last_cell = std::vector<std::vector<std::pair<size_t, unsigned long long>>>(64*BITFIELD_WORDS);
+    next = 0;
+    stamp = 0;
+    added = 0;
+    hits = 0;
+}
+
+void nogood_store::add(nogood& ng, int last_cell) {
+    // the index entry for whatever lived in this slot goes stale, and is
+    // dropped the next time its list is scanned
+    slots[next] = ng;
+    stamps[next] = ++stamp;
+    by_last_cell[last_cell].push_back({next, stamp});
+    next = (next + 1) % slots.size();
+    added++;
+}
+
+// a stored nogood with at least the given bound that the placement satisfies
+const nogood* nogood_store::match(bitfield& left, bitfield& right, int last_cell, int at_least) {
+    auto& entries = by_last_cell[last_cell];
+    for (size_t i = 0; i < entries.size(); ) {
+        if (stamps[entries[i].first] != entries[i].second) {
+            entries[i] = entries.back();
+            entries.pop_back();
+            continue;
+        }
+        nogood& ng = slots[entries[i].first];
+        if (ng.bound >= at_least && subset_of(ng.left, left) && subset_of(ng.right, right)) {
+            hits++;
+            return &ng;
+        }
+        ++i;
+    }
+    return nullptr;
+}
@@ -0,0 +1,36 @@
+#ifndef __NOGOOD_H__
+#define __NOGOOD_H__
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include "bitfield.h"
+
+// a set of cell placements that no completion can improve on: every
+// partition with these cells on these sides cuts at least `bound`
+struct nogood {
+    bitfield left;
+    bitfield right;
+    int bound;
+};
+
+// fixed number of nogoods, the oldest overwritten first.  they are indexed
+// by their last cell in branching order: when that cell is placed, all the
+// others already are, so only those nogoods need checking
+class nogood_store {
+    std::vector<nogood> slots;
+    std::vector<unsigned long long> stamps;
+    std::vector<std::vector<std::pair<size_t, unsigned long long>>> by_last_cell;
+    size_t next;
+    unsigned long long stamp;
+
+    public:
+        unsigned long long added;
+        unsigned long long hits;
+
+        nogood_store(size_t capacity);
+        void add(nogood& ng, int last_cell);
+        const nogood* match(bitfield& left, bitfield& right, int last_cell, int at_least);
+        size_t size() { return added < slots.size() ? added : slots.size(); }
+};
+#endif
@@ -1,12 +1,15 @@
 #include "partition.h"
 #include "bitfield.h"
 #include "circuit.h"
+#include "kernels.h"
 #include "spdlog/spdlog.h"
 #include <queue>
 #include <vector>
 #include <algorithm>
 #include <numeric>
 #include <list>
+#include <fstream>
+#include <cstdio>
 
 // the decision tree just exists,
 // any given node in the tree represents a partial or complete set of decisions
@@ -15,31 +18,76 @@ bool cell_sort_most_nets(cell* a, cell* b);
 bool sort_by_most_mutual_to_g_supercell(cell* a, cell* b);
 
 a3::partition::partition() {
+    circ = nullptr;
+    cut_weight = 0;
+    vl_area = 0;
+    vr_area = 0;
+    net_span = 0;
+    cell_span = 0;
 }
 
 a3::partition::partition(circuit* c) {
     circ = c;
+    cut_weight = 0;
+    vl_area = 0;
+    vr_area = 0;
     //spdlog::debug("new partition: {}", to_string());
 
-
-    // initially, all nets are uncut
+    int max_net = -1, max_cell = -1;
+    for(auto nl : circ->get_nets()) {
+        max_net = std::max(max_net, nl->label);
+    }
+    for(auto cl : circ->get_cells()) {
+        max_cell = std::max(max_cell, cl->label);
+    }
+    // padded for the bound kernels
+    net_span = kernel_padded(max_net + 1);
+    cell_span = kernel_padded(max_cell + 1);
+    std::fill(net_free_area, net_free_area + net_span, 0);
+    std::fill(net_free_pins, net_free_pins + net_span, 0);
+    std::fill(anchored_left, anchored_left + cell_span, 0);
+    std::fill(anchored_right, anchored_right + cell_span, 0);
+
+    // initially, all nets are uncut and all their cells are free
     for(auto nl : circ->get_nets()) {
         uncut_nets.set(nl->label);
+        nl->cell_labels.for_each([&](int cl) {
+            net_free_area[nl->label] += circ->get_cell(cl)->area;
+            net_free_pins[nl->label]++;
+        });
     }
     for(auto cl : circ->get_cells()) {
         unassigned_cells.set(cl->label);
     }
 }
 
-a3::partition::partition(a3::partition* other) {
-    circ = other->circ;
-    vr_cells = other->vr_cells;
-    vl_cells = other->vl_cells;
-    vr_nets = other->vr_nets;
-    vl_nets = other->vl_nets;
-    unassigned_cells = other->unassigned_cells;
-    uncut_nets = other->uncut_nets;
-    cut_nets = other->cut_nets;
+a3::partition::partition(a3::partition* other) : partition(*other) {
+}
+
+a3::partition::partition(const a3::partition& other) {
+    *this = other;
+}
+
+// copies only the spans of the bound arrays that are in use
+a3::partition& a3::partition::operator=(const a3::partition& other) {
+    circ = other.circ;
+    vr_cells = other.vr_cells;
+    vl_cells = other.vl_cells;
+    vr_nets = other.vr_nets;
+    vl_nets = other.vl_nets;
+    unassigned_cells = other.unassigned_cells;
+    uncut_nets = other.uncut_nets;
+    cut_nets = other.cut_nets;
+    cut_weight = other.cut_weight;
+    vl_area = other.vl_area;
+    vr_area = other.vr_area;
+    net_span = other.net_span;
+    cell_span = other.cell_span;
+    std::copy(other.net_free_area, other.net_free_area + net_span, net_free_area);
+    std::copy(other.net_free_pins, other.net_free_pins + net_span, net_free_pins);
+    std::copy(other.anchored_left, other.anchored_left + cell_span, anchored_left);
+    std::copy(other.anchored_right, other.anchored_right + cell_span, anchored_right);
+    return *this;
 }
 
 string a3::partition::to_string()
@@ -61,43 +109,106 @@ string a3::partition::to_string()
         return os.str();
 };
 
+// total weight of the cut nets
 int a3::partition::cost() {
-    return cut_nets.size;
+    return cut_weight;
 }
 
-void a3::partition::update_cut_nets() {
-    for (auto nl : uncut_nets.to_vec()) {
-        if (vr_nets.get(nl) && vl_nets.get(nl)) {
-            uncut_nets.clear(nl);
-            cut_nets.set(nl);
-        }
-    }
+bool a3::partition::fits_left(cell* c) {
+    return vl_area + c->area <= circ->get_left_capacity();
+}
+
+bool a3::partition::fits_right(cell* c) {
+    return vr_area + c->area <= circ->get_right_capacity();
+}
+
+bool a3::partition::is_balanced() {
+    return vl_area <= circ->get_left_capacity() && vr_area <= circ->get_right_capacity();
+}
+
+int a3::partition::min_unassigned_area() {
+    int result = INT_MAX;
+    unassigned_cells.for_each([&](int cl) {
+        result = std::min(result, circ->get_cell(cl)->area);
+    });
+    return result;
 }
 
 void a3::partition::assign_left(cell* c) {
-    unassigned_cells.clear(c->label);
-    vl_cells.set(c->label);
-    for(auto nl : c->net_labels.to_vec()) {
-        vl_nets.set(nl);
-    }
-    update_cut_nets();
+    assign(c, false);
 }
 
 void a3::partition::assign_right(cell* c) {
+    assign(c, true);
+}
+
+// place c and bring the bound state up to date.  only c's nets can change,
+// and each net's pins are only walked when it first gets a pin on a side,
+// at most twice along any path
+void a3::partition::assign(cell* c, bool right) {
     unassigned_cells.clear(c->label);
-    vr_cells.set(c->label);
-    for(auto nl : c->net_labels.to_vec()) {
-        vr_nets.set(nl);
-    }
-    update_cut_nets();
+    (right ? vr_area : vl_area) += c->area;
+    (right ? vr_cells : vl_cells).set(c->label);
+    bitfield& own_nets = right ? vr_nets : vl_nets;
+    bitfield& other_nets = right ? vl_nets : vr_nets;
+    int* own_anchored = right ? anchored_right : anchored_left;
+    int* other_anchored = right ? anchored_left : anchored_right;
+
+    c->net_labels.for_each([&](int nl) {
+        net_free_area[nl] -= c->area;
+        net_free_pins[nl]--;
+        if (own_nets.get(nl)) {
+            return;
+        }
+        own_nets.set(nl);
+        net* n = circ->get_net(nl);
+        if (other_nets.get(nl)) {
+            // was anchored to the other side only, now it spans both
+            uncut_nets.clear(nl);
+            cut_nets.set(nl);
+            cut_weight += n->weight;
+            n->cell_labels.for_each([&](int cl) { other_anchored[cl] -= n->weight; });
+        } else {
+            n->cell_labels.for_each([&](int cl) { own_anchored[cl] += n->weight; });
+        }
+    });
 }
 
+// rebuild a partition from its left/right cell sets, e.g. when resuming
+void a3::partition::assign_from(bitfield& left, bitfield& right) {
+    for(auto cl : left.to_vec()) {
+        assign_left(circ->get_cell(cl));
+    }
+    for(auto cl : right.to_vec()) {
+        assign_right(circ->get_cell(cl));
+    }
+}
 
+// place the cells the circuit pins to a side
+void a3::partition::assign_fixed() {
+    for(auto cl : circ->get_fixed_left().to_vec()) {
+        assign_left(circ->get_cell(cl));
+    }
+    for(auto cl : circ->get_fixed_right().to_vec()) {
+        assign_right(circ->get_cell(cl));
+    }
+}
 
 // lower bound function
-// right now - just use the number of cut nets
+// cut nets so far, plus the cuts any completion is guaranteed to add
 int a3::partition::lb() {
-    return cost();
+    // these are different measures, there can be overlap, so cant apply both
+    bitfield guaranteed_cuts = num_guaranteed_cut_nets();
+    bitfield full_partition_cuts = one_partition_full_cut_nets();
+    int anchored_cuts = 0;
+
+    bitfield added = guaranteed_cuts.union_with(full_partition_cuts);
+    if (full_partition_cuts.size == 0) {
+        anchored_cuts = min_number_anchored_nets_cut(&added);
+    }
+
+    int min_added_cuts = circ->weight_of(added) + anchored_cuts;
+    return cost() + min_added_cuts;
 }
 
 bool cell_sort_most_nets(cell* a, cell* b) {
@@ -107,24 +218,37 @@ bool cell_sort_most_nets(cell* a, cell* b) {
 
 void a3::partition::initial_solution() {
     initial_solution_heur1();
+    if (is_balanced()) {
+        refine();
+    }
     bool beat_heuristic = false;
     for(int i = 0; i < 100000; ++i) {
         a3::partition rand = a3::partition(this);
 
         rand.initial_solution_random();
-        if (rand.cut_nets.size < cut_nets.size) {
+        if (rand.is_balanced() && (!is_balanced() || rand.cost() < cost())) {
             beat_heuristic = true;
-            vr_cells = rand.vr_cells;
-            vl_cells = rand.vl_cells;
-            vr_nets = rand.vr_nets;
-            vl_nets = rand.vl_nets;
-            unassigned_cells = rand.unassigned_cells;
-            uncut_nets = rand.uncut_nets;
-            cut_nets = rand.cut_nets;
+            *this = rand;
         }
     }
     if (!beat_heuristic) {
         spdlog::info("didnt beat heuristic");
+    } else {
+        refine();
+    }
+    if (!is_balanced()) {
+        // nothing feasible yet - make sure any balanced leaf beats this
+        spdlog::warn("no balanced initial solution found");
+        cut_weight = circ->get_total_weight() + 1;
+    }
+}
+
+void a3::partition::initial_solution_greedy() {
+    initial_solution_heur1();
+    if (is_balanced()) {
+        refine();
+    } else {
+        cut_weight = circ->get_total_weight() + 1;
     }
 }
 
@@ -133,26 +257,20 @@ void a3::partition::initial_solution_random() {
     srand(time(NULL));
     vector<cell*> unassigned = circ->get_cells();
 
-    vr_cells = bitfield();
-    vl_cells = bitfield();
-    vr_nets = bitfield();
-    vl_nets = bitfield();
-    cut_nets = bitfield();
-    unassigned_cells = bitfield();
-    uncut_nets = bitfield();
-
-    for(auto nl : circ->get_nets()) {
-        uncut_nets.set(nl->label);
-    }
+    *this = a3::partition(circ);
 
-    for(auto cl : circ->get_cells()) {
-        unassigned_cells.set(cl->label);
-    }
+    assign_fixed();
+    unassigned.erase(std::remove_if(unassigned.begin(), unassigned.end(),
+                [this](cell* c){ return circ->is_fixed(c->label); }), unassigned.end());
 
     while(!unassigned.empty()) {
         int random_index = rand() % unassigned.size();
         cell* c = unassigned[random_index];
 
+        // take the other side if this one has no room left
+        if (insert_right ? !fits_right(c) : !fits_left(c)) {
+            insert_right = !insert_right;
+        }
         insert_right ? assign_right(c) : assign_left(c);
 
         insert_right = !insert_right;
@@ -191,44 +309,75 @@ bitfield a3::partition::make_left_supercell() {
 
 void a3::partition::initial_solution_heur1() {
     // sort nets by their fanout
-    std::vector<cell*> cells_fanout = std::vector<cell*>(circ->get_cells());
+    std::vector<cell*> cells_fanout;
+    for(auto c : circ->get_cells()) {
+        if (!circ->is_fixed(c->label)) {
+            cells_fanout.push_back(c);
+        }
+    }
     std::sort(cells_fanout.begin(), cells_fanout.end(), cell_sort_most_nets);
 
-    cell* lcell = *cells_fanout.begin();
-    assign_left(lcell);
-
-    cell* rcell = *cells_fanout.begin();
-
-    int score = 0;
-    for (auto c : cells_fanout) {
-        int new_score = 0;
-        int n_mutual_nets = lcell->get_num_mutual_net_labels(c);
-        int n_r_nets = c->net_labels.size;
-        int n_l_nets = lcell->net_labels.size;
-        int n_unique_r_nets = n_r_nets - n_mutual_nets;
-        int n_unique_l_nets = n_l_nets - n_mutual_nets;
-
-        new_score = (n_unique_r_nets)*(n_unique_l_nets);
-        if (new_score > score) {
-            score = new_score;
-            rcell = c;
+    // fixed cells already seed both sides, otherwise pick a pair of seeds
+    assign_fixed();
+    if (circ->get_n_fixed() == 0 && cells_fanout.size() >= 2) {
+        cell* lcell = *cells_fanout.begin();
+        assign_left(lcell);
+        cells_fanout.erase(cells_fanout.begin());
+
+        auto rpos = cells_fanout.begin();
+
+        int score = 0;
+        for (auto it = cells_fanout.begin(); it < cells_fanout.end(); ++it) {
+            cell* c = *it;
+            int new_score = 0;
+            int n_mutual_nets = lcell->get_num_mutual_net_labels(c);
+            int n_r_nets = c->net_labels.size;
+            int n_l_nets = lcell->net_labels.size;
+            int n_unique_r_nets = n_r_nets - n_mutual_nets;
+            int n_unique_l_nets = n_l_nets - n_mutual_nets;
+
+            new_score = (n_unique_r_nets)*(n_unique_l_nets);
+            if (new_score > score) {
+                score = new_score;
+                rpos = it;
+            }
         }
+        assign_right(*rpos);
+        cells_fanout.erase(rpos);
     }
-    assign_right(rcell);
 
     bool insert_right = false;
     while (cells_fanout.size() > 0) {
-        bitfield supernet = insert_right ? make_right_supercell() : make_left_supercell();
-        auto iter = cells_fanout.begin();
-        std::vector<cell*>::iterator best_pos = iter;
-        int score = (*best_pos)->net_labels.intersection_with(supernet).size;
-        while(iter < cells_fanout.end()) {
-            int new_score = (*iter)->net_labels.intersection_with(supernet).size;
-            if (new_score > score) {
-                score = new_score;
-                best_pos = iter;
+        // fill whichever side has more room left, alternating on a tie
+        int room_left = circ->get_left_capacity() - vl_area;
+        int room_right = circ->get_right_capacity() - vr_area;
+        if (room_left != room_right) {
+            insert_right = room_right > room_left;
+        }
+
+        // best affinity to that side among the cells that still fit there
+        std::vector<cell*>::iterator best_pos = cells_fanout.end();
+        for (int attempt = 0; attempt < 2 && best_pos == cells_fanout.end(); ++attempt) {
+            bitfield supernet = insert_right ? make_right_supercell() : make_left_supercell();
+            int score = -1;
+            for (auto iter = cells_fanout.begin(); iter < cells_fanout.end(); ++iter) {
+                if (insert_right ? !fits_right(*iter) : !fits_left(*iter)) {
+                    continue;
+                }
+                int new_score = (*iter)->net_labels.intersection_with(supernet).size;
+                if (new_score > score) {
+                    score = new_score;
+                    best_pos = iter;
+                }
+            }
+            if (best_pos == cells_fanout.end()) {
+                insert_right = !insert_right;
             }
-            iter++;
+        }
+        if (best_pos == cells_fanout.end()) {
+            // nothing fits anywhere, initial_solution will notice
+            best_pos = cells_fanout.begin();
+            insert_right = room_right > room_left;
         }
 
         insert_right ? assign_right(*best_pos) : assign_left(*best_pos);
@@ -236,11 +385,78 @@ void a3::partition::initial_solution_heur1() {
         insert_right = !insert_right;
         cells_fanout.erase(best_pos);
     }
-    assert(vl_cells.size == vr_cells.size);
 }
 
-cell* a3::partition::next_unassigned(vector<cell*> cell_prio_list) {
-    return cell_prio_list[vr_cells.size + vl_cells.size];
+// greedy single-cell moves on a complete partition: keep moving the cell
+// with the best positive gain to the other side, as long as it fits there.
+// this is where a balance tolerance pays off for the heuristics
+void a3::partition::refine() {
+    if (unassigned_cells.size != 0) {
+        return;
+    }
+
+    vector<cell*> cells = circ->get_cells();
+    bitfield left = vl_cells;
+    bitfield right = vr_cells;
+    int left_cap = circ->get_left_capacity();
+    int right_cap = circ->get_right_capacity();
+    int left_area = vl_area;
+    int right_area = vr_area;
+
+    while (true) {
+        cell* best_cell = nullptr;
+        int best_gain = 0;
+        for (auto c : cells) {
+            if (circ->is_fixed(c->label)) {
+                continue;
+            }
+            bool on_left = left.get(c->label);
+            bitfield& from = on_left ? left : right;
+            bitfield& to = on_left ? right : left;
+            if (on_left ? (right_area + c->area > right_cap) : (left_area + c->area > left_cap)) {
+                continue;
+            }
+
+            int gain = 0;
+            for (auto nl : c->net_labels.to_vec()) {
+                net* n = circ->get_net(nl);
+                int from_pins = n->cell_labels.intersection_with(from).size;
+                int to_pins = n->cell_labels.intersection_with(to).size;
+                if (from_pins == 1 && to_pins > 0) {
+                    gain += n->weight;  // no longer cut
+                } else if (from_pins > 1 && to_pins == 0) {
+                    gain -= n->weight;  // becomes cut
+                }
+            }
+            if (gain > best_gain) {
+                best_gain = gain;
+                best_cell = c;
+            }
+        }
+
+        if (best_cell == nullptr) {
+            break;
+        }
+        if (left.get(best_cell->label)) {
+            left.clear(best_cell->label);
+            right.set(best_cell->label);
+            left_area -= best_cell->area;
+            right_area += best_cell->area;
+        } else {
+            right.clear(best_cell->label);
+            left.set(best_cell->label);
+            right_area -= best_cell->area;
+            left_area += best_cell->area;
+        }
+    }
+
+    *this = a3::partition(circ);
+    assign_from(left, right);
+}
+
+// the priority list only holds the free cells, fixed ones are assigned up front
+cell* a3::partition::next_unassigned(const vector<cell*>& cell_prio_list) {
+    return cell_prio_list[vr_cells.size + vl_cells.size - circ->get_n_fixed()];
 }
 
 void a3::partition::print_cut_nets() {
@@ -254,226 +470,986 @@ void a3::partition::print_cut_nets() {
 }
 
 pnode::pnode() {
+    level = 0;
 }
 
-pnode* traverser::dfs_step() {
-    pnode* rc = nullptr;
-    if (!pq.empty()) {
-        pnode* pn = pq.top(); pq.pop();
-
-
-        visited_nodes++;
-        if (pn->p.unassigned_cells.size > 0) {
-
-            // explore putting it on the left
-            if (!prune_imbalance || (pn->p.vl_cells.size < cells.size()/2 )) {
-                pn->left = new pnode();
-
-                // UI drawing related
-                pn->left->level = pn->level + 1;
-                pn->left->y = pn->y + 64.0*PNODE_DIAMETER;
-                int levels_to_leaf = cells.size() - pn->level -2;
-                pn->left->x = pn->x - PNODE_DIAMETER*(2<<levels_to_leaf);
-
-                pn->left->parent = pn;
-                pn->left->p = a3::partition(pn->p);
-                pn->left->p.assign_left( pn->p.next_unassigned(cells) );
-                if (!prune_lb || !prune(&pn->left->p, best)) {
-                    pq.push(pn->left);
-                } else {
-                    delete pn->left;
-                    pn->left = nullptr;
-                }
-            } else {
-                spdlog::debug("pruning: imbalance");
-            }
+static const char* TIE_BREAK_NAMES[] = {"lifo", "fifo", "deepest"};
 
-            // explore putting it on the right
-            if ( (pn->level > 0 || !prune_symmetry) && (!prune_imbalance || (pn->p.vr_cells.size < cells.size()/2 ))) {
-                pn->right = new pnode();
-                
-                // UI drawing related
-                pn->right->level = pn->level + 1;
-                pn->right->y = pn->y + 64.0*PNODE_DIAMETER;
-                int levels_to_leaf = cells.size() - pn->level -2;
-                pn->right->x = pn->x + PNODE_DIAMETER*(2<<levels_to_leaf);
-
-                pn->right->parent = pn;
-                pn->right->p = a3::partition(pn->p);
-                pn->right->p.assign_right(pn->p.next_unassigned(cells));
-                if (!prune_lb || !prune(&pn->right->p, best)) {
-                    pq.push(pn->right);
-                } else {
-                    delete pn->right;
-                    pn->right = nullptr;
-                }
-            } else {
-                spdlog::debug("pruning: imbalance");
+const char* tie_break_name(tie_break ties) {
+    return TIE_BREAK_NAMES[ties];
+}
+
+bool parse_tie_break(std::string name, tie_break& ties) {
+    for (int i = TIES_LIFO; i <= TIES_DEEPEST; ++i) {
+        if (name == TIE_BREAK_NAMES[i]) {
+            ties = (tie_break)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+pnode_queue::pnode_queue(tie_break ties, size_t levels) {
+    this->ties = ties;
+    this->levels = levels;
+    base = 0;
+    first = 0;
+    count = 0;
+}
+
+// cost major; with TIES_DEEPEST, deeper nodes get the lower key of a cost
+size_t pnode_queue::key(pnode* pn) {
+    size_t k = (size_t)pn->p.cost()*(levels + 1);
+    if (ties == TIES_DEEPEST) {
+        k += levels - std::min((size_t)pn->level, levels);
+    }
+    return k;
+}
+
+// moves the window to start at or below new_base, which no live key is
+// below.  it starts where new_base's cost does, so the children of a node,
+// which cost no less, do not move it again however deep they are.
+// buckets keep their order wherever they move, so ties still break the same
+void pnode_queue::rebase(size_t new_base) {
+    new_base -= new_base % (levels + 1);
+    for (size_t i = first; i < buckets.size(); ++i) {
+        if (buckets[i].head != buckets[i].nodes.size()) {
+            far.emplace(base + i, std::move(buckets[i]));
+        }
+    }
+    buckets.clear();
+    base = new_base;
+    first = 0;
+    while (!far.empty() && far.begin()->first - base < PNODE_QUEUE_WINDOW) {
+        size_t i = far.begin()->first - base;
+        buckets.resize(i + 1, bucket{std::vector<pnode*>(), 0});
+        buckets[i] = std::move(far.begin()->second);
+        far.erase(far.begin());
+    }
+}
+
+void pnode_queue::push(pnode* pn) {
+    size_t k = key(pn);
+    if (count == 0 || k < base) {
+        rebase(k);
+    }
+    if (k - base >= PNODE_QUEUE_WINDOW) {
+        bucket& b = far[k];
+        b.nodes.push_back(pn);
+    } else {
+        size_t i = k - base;
+        if (i >= buckets.size()) {
+            buckets.resize(i + 1, bucket{std::vector<pnode*>(), 0});
+        }
+        buckets[i].nodes.push_back(pn);
+        first = std::min(first, i);
+    }
+    count++;
+}
+
+pnode* pnode_queue::top() {
+    while (true) {
+        while (first < buckets.size() && buckets[first].head == buckets[first].nodes.size()) {
+            first++;
+        }
+        if (first < buckets.size()) {
+            break;
+        }
+        // the window is empty, so the lowest key left is in far
+        rebase(far.begin()->first);
+    }
+    bucket& b = buckets[first];
+    return ties == TIES_FIFO ? b.nodes[b.head] : b.nodes.back();
+}
+
+void pnode_queue::pop() {
+    top();
+    bucket& b = buckets[first];
+    if (ties == TIES_FIFO) {
+        b.head++;
+    } else {
+        b.nodes.pop_back();
+    }
+    if (b.head == b.nodes.size()) {
+        b.nodes.clear();
+        b.head = 0;
+    }
+    count--;
+}
+
+std::vector<pnode*> pnode_queue::nodes() {
+    std::vector<pnode*> ret;
+    ret.reserve(count);
+    auto append = [&](bucket& b) {
+        if (ties == TIES_FIFO) {
+            ret.insert(ret.end(), b.nodes.begin() + b.head, b.nodes.end());
+        } else {
+            ret.insert(ret.end(), b.nodes.rbegin(), b.nodes.rend() - b.head);
+        }
+    };
+    for (size_t i = first; i < buckets.size(); ++i) {
+        append(buckets[i]);
+    }
+    for (auto& it : far) {
+        append(it.second);
+    }
+    return ret;
+}
+
+void pnode_queue::restore(const std::vector<pnode*>& in_pop_order) {
+    buckets.clear();
+    far.clear();
+    base = 0;
+    first = 0;
+    count = 0;
+    if (ties == TIES_FIFO) {
+        for (auto pn : in_pop_order) {
+            push(pn);
+        }
+    } else {
+        for (auto it = in_pop_order.rbegin(); it != in_pop_order.rend(); ++it) {
+            push(*it);
+        }
+    }
+}
+
+// lex-leader symmetry breaking.  for every symmetry s of the netlist, the
+// assignment read in branching order (left before right) may not be larger
+// than the one s maps it to; some member of every class of equivalent
+// solutions passes.  for interchangeable cells this just means their left
+// members come first
+static int side_of(a3::partition& p, int label, cell* c, bool right) {
+    if (label == c->label) {
+        return right ? 1 : 0;
+    }
+    if (p.vl_cells.get(label)) {
+        return 0;
+    }
+    return p.vr_cells.get(label) ? 1 : -1;
+}
+
+bool traverser::lex_leader_ok(a3::partition& p, cell* c, bool right) {
+    for(auto g : lex_pairs_of[c->label]) {
+        for(auto& pr : lex_pairs[g]) {
+            int a = side_of(p, pr.first, c, right);
+            int b = side_of(p, pr.second, c, right);
+            if (a < 0 || b < 0 || a < b) {
+                break;
+            }
+            if (a > b) {
+                return false;
             }
-        } else { 
-            spdlog::debug("leaf node: {}", pn->p.cost());
-            int tcost = pn->p.cost();
-            int bcost = (*best)->cost();
-            prune(&pn->p, best);
         }
-        rc = pn;
-    } 
-    return rc;
+    }
+    return true;
+}
+
+// with mirror-image sides the first cell can stay on the left
+bool traverser::symmetry_allows(pnode* pn, cell* c, bool right) {
+    if (right && pn->level == 0 && symmetric) {
+        return false;
+    }
+    return lex_leader_ok(pn->p, c, right);
+}
+
+bool traverser::may_go_left(pnode* pn) {
+    return !prune_symmetry || symmetry_allows(pn, pn->p.next_unassigned(cells), false);
+}
+
+bool traverser::may_go_right(pnode* pn) {
+    return !prune_symmetry || symmetry_allows(pn, pn->p.next_unassigned(cells), true);
+}
+
+/****
+*
+* nogood learning
+*
+* when a node is pruned on its bound, the cells that bound actually rests
+* on are usually far fewer than the cells on its path: one pin on each side
+* of every cut net and one pin of every other net that is anchored.  any
+* other node that has those cells on those sides fails the same way, so the
+* placements are stored and checked before a child is kept.  depth first
+* (iterative deepening) search also learns from whole subtrees: once both
+* children of a node have failed for known reasons, the union of those
+* reasons, less the branching cell, is why the node failed.
+*
+****/
+
+static bitfield without(bitfield a, bitfield& b) {
+    for(auto l : b.to_vec()) {
+        a.clear(l);
+    }
+    return a;
+}
+
+// fills ng with placements from p whose bound on their own reaches target.
+// returns false if only the whole of p's path does
+bool traverser::explain(a3::partition& p, int target, nogood& ng) {
+    ng.left = bitfield();
+    ng.right = bitfield();
+    bitfield need_left = p.vl_nets;
+    bitfield need_right = p.vr_nets;
+    for(auto cl : circ->get_fixed_left().to_vec()) {
+        need_left = without(need_left, circ->get_cell(cl)->net_labels);
+    }
+    for(auto cl : circ->get_fixed_right().to_vec()) {
+        need_right = without(need_right, circ->get_cell(cl)->net_labels);
+    }
+    // free cells are placed in branching order, so the earliest pins are
+    // the ones on the path's prefix
+    for(auto cl : cells) {
+        if (p.unassigned_cells.get(cl->label)) {
+            break;
+        }
+        bool right = p.vr_cells.get(cl->label);
+        bitfield& need = right ? need_right : need_left;
+        bitfield hit = cl->net_labels.intersection_with(need);
+        if (hit.size > 0) {
+            (right ? ng.right : ng.left).set(cl->label);
+            need = without(need, hit);
+        }
+    }
+
+    a3::partition e(circ);
+    e.assign_fixed();
+    e.assign_from(ng.left, ng.right);
+    ng.bound = prune_lb ? e.lb() : e.cost();
+    if (ng.bound >= target) {
+        return true;
+    }
+    ng.left = without(p.vl_cells, circ->get_fixed_left());
+    ng.right = without(p.vr_cells, circ->get_fixed_right());
+    ng.bound = target;
+    return false;
+}
+
+void traverser::learn(nogood& ng) {
+    if (!learn_nogoods || ng.left.size + ng.right.size == 0) {
+        return;
+    }
+    if (nogoods == nullptr) {
+        nogoods = new nogood_store(nogood_limit);
+    }
+    int last = -1;
+    for(auto l : ng.left.union_with(ng.right).to_vec()) {
+        if (last < 0 || position[l] > position[last]) {
+            last = l;
+        }
+    }
+    nogoods->add(ng, last);
+}
+
+// child has just had c placed
+bool traverser::known_failure(a3::partition& child, cell* c, int at_least, nogood& ng) {
+    if (nogoods == nullptr) {
+        return false;
+    }
+    const nogood* found = nogoods->match(child.vl_cells, child.vr_cells, c->label, at_least);
+    if (found == nullptr) {
+        return false;
+    }
+    ng = *found;
+    return true;
+}
+
+/****
+*
+* search policies
+*
+* the frontier searches are one loop, compiled once per queue and per set
+* of pruning flags so the checks a configuration never makes fold away and
+* the usual bound is called directly.  a prune function other than
+* prune_basic_cost takes the copy that reads the flags at run time
+*
+****/
+
+#define POLICY_FLAG(bit, member) ((POLICY & POLICY_RUNTIME) ? (member) : (POLICY & (bit)) != 0)
+
+template<int POLICY> bool traverser::bound_prunes(a3::partition* p) {
+    return (POLICY & POLICY_RUNTIME) ? prune(p, best) : prune_basic_cost(p, best);
+}
+
+template<int POLICY> bool traverser::keep_child(a3::partition& child, cell* c) {
+    nogood ng;
+    if (known_failure(child, c, (*best)->cost(), ng)) {
+        return false;
+    }
+    if (POLICY_FLAG(POLICY_LB, prune_lb) && bound_prunes<POLICY>(&child)) {
+        if (learn_nogoods && explain(child, (*best)->cost(), ng)) {
+            learn(ng);
+        }
+        return false;
+    }
+    return true;
+}
+
+// children sit half way between their parent and the edge of its span,
+// so no level runs out of room however deep the tree
+static inline double child_offset(int level) {
+    return ldexp(0.25, -level);
+}
+
+// the first `level` branching decisions, read back from the right side
+double traverser::tree_x(bitfield& right, int level) {
+    double x = 0.5;
+    for(int l = 0; l < level && l < (int)cells.size(); ++l) {
+        x += right.get(cells[l]->label) ? child_offset(l) : -child_offset(l);
+    }
+    return x;
+}
+
+void traverser::retire() {
+    if (retired == nullptr || retired == root) {
+        retired = nullptr;
+        return;
+    }
+    if (*best == &retired->p) {
+        delete incumbent_node;
+        incumbent_node = retired;
+    } else {
+        delete retired;
+    }
+    retired = nullptr;
+}
+
+void traverser::free_frontier() {
+    for (auto pn : pq.nodes()) {
+        if (pn != root) {
+            delete pn;
+        }
+    }
+    for (; !q_bfs.empty(); q_bfs.pop()) {
+        if (q_bfs.front() != root) {
+            delete q_bfs.front();
+        }
+    }
+}
+
+static inline pnode* take(std::queue<pnode*>& q) {
+    pnode* pn = q.front();
+    q.pop();
+    return pn;
+}
+
+static inline pnode* take(pnode_queue& q) {
+    pnode* pn = q.top();
+    q.pop();
+    return pn;
+}
+
+template<int POLICY, typename Q> pnode* traverser::expand(Q& frontier) {
+    retire();
+    if (frontier.empty()) {
+        return nullptr;
+    }
+    pnode* pn = take(frontier);
+    retired = pn;
+    visited_nodes++;
+
+    if (pn->p.unassigned_cells.size == 0) {
+        spdlog::debug("leaf node: {}", pn->p.cost());
+        bound_prunes<POLICY>(&pn->p);
+        return pn;
+    }
+
+    cell* c = pn->p.next_unassigned(cells);
+    for (int side = 0; side < 2; ++side) {
+        bool right = side == 1;
+        if (POLICY_FLAG(POLICY_SYMMETRY, prune_symmetry) && !symmetry_allows(pn, c, right)) {
+            continue;
+        }
+        if (POLICY_FLAG(POLICY_IMBALANCE, prune_imbalance) && !(right ? pn->p.fits_right(c) : pn->p.fits_left(c))) {
+            spdlog::debug("pruning: imbalance");
+            continue;
+        }
+        pnode* child = new pnode();
+        child->level = pn->level + 1;
+        child->p = a3::partition(pn->p);
+        child->p.assign(c, right);
+        if (keep_child<POLICY>(child->p, c)) {
+            frontier.push(child);
+        } else {
+            delete child;
+        }
+    }
+    return pn;
+}
+
+template<int POLICY> pnode* traverser::best_first_step() {
+    return expand<POLICY>(pq);
+}
+
+template<int POLICY> pnode* traverser::breadth_first_step() {
+    return expand<POLICY>(q_bfs);
+}
+
+#undef POLICY_FLAG
+
+traverser::step_fn traverser::frontier_step(bool breadth_first) {
+    static const step_fn best_first[] = {
+        &traverser::best_first_step<0>, &traverser::best_first_step<1>,
+        &traverser::best_first_step<2>, &traverser::best_first_step<3>,
+        &traverser::best_first_step<4>, &traverser::best_first_step<5>,
+        &traverser::best_first_step<6>, &traverser::best_first_step<7>,
+    };
+    static const step_fn breadth[] = {
+        &traverser::breadth_first_step<0>, &traverser::breadth_first_step<1>,
+        &traverser::breadth_first_step<2>, &traverser::breadth_first_step<3>,
+        &traverser::breadth_first_step<4>, &traverser::breadth_first_step<5>,
+        &traverser::breadth_first_step<6>, &traverser::breadth_first_step<7>,
+    };
+    if (prune != prune_basic_cost) {
+        return breadth_first ? &traverser::breadth_first_step<POLICY_RUNTIME> : &traverser::best_first_step<POLICY_RUNTIME>;
+    }
+    int policy = (prune_imbalance ? POLICY_IMBALANCE : 0) |
+        (prune_symmetry ? POLICY_SYMMETRY : 0) |
+        (prune_lb ? POLICY_LB : 0);
+    return breadth_first ? breadth[policy] : best_first[policy];
+}
+
+pnode* traverser::dfs_step() {
+    return (this->*frontier_step(false))();
 }
 
 pnode* traverser::bfs_step() {
-    pnode* rc = nullptr;
-    if (!q_bfs.empty()) {
-        pnode* pn = q_bfs.front(); q_bfs.pop();
-
-
-        visited_nodes++;
-        if (pn->p.unassigned_cells.size > 0) {
-
-            // explore putting it on the left
-            if (!prune_imbalance || (pn->p.vl_cells.size < cells.size()/2 )) {
-                pn->left = new pnode();
-
-                // UI drawing related
-                pn->left->level = pn->level + 1;
-                pn->left->y = pn->y + 64.0*PNODE_DIAMETER;
-                int levels_to_leaf = cells.size() - pn->level -2;
-                pn->left->x = pn->x - PNODE_DIAMETER*(2<<levels_to_leaf);
-
-                pn->left->parent = pn;
-                pn->left->p = a3::partition(pn->p);
-                pn->left->p.assign_left( pn->p.next_unassigned(cells) );
-                if (!prune_lb || !prune(&pn->left->p, best)) {
-                    q_bfs.push(pn->left);
-                } else {
-                    delete pn->left;
-                    pn->left = nullptr;
+    return (this->*frontier_step(true))();
+}
+
+/****
+*
+* iterative deepening
+*
+* repeated depth first passes, each cutting off any node whose lower bound
+* exceeds the current threshold.  the threshold starts at the root's bound
+* and rises to the smallest bound that was cut off in the previous pass.
+* only the current path is kept, so memory is O(depth).
+*
+* leaves are copied out before the stack slot is reused, so this does not
+* go through the prune callback (which keeps a pointer to the leaf).
+*
+****/
+
+static const int IDA_UNVISITED = -1;
+
+// also where a resumed search starts, so the table is made here
+void traverser::ida_restart(int threshold) {
+    if (tt_megabytes > 0 && tt == nullptr) {
+        tt = new transposition_table(tt_megabytes);
+    }
+    ida_started = true;
+    ida_threshold = threshold;
+    ida_next_threshold = INT_MAX;
+    ida_pass_nodes = 0;
+    ida_stack[0] = *root;
+    ida_depth = 0;
+    ida_branch[0] = IDA_UNVISITED;
+}
+
+// a child of the node at depth failed for the given reason, which may
+// still name the cell the node branches on.  the bound is kept either way,
+// for the transposition table
+void traverser::ida_note_failure(int depth, nogood& child_failure, bool explained) {
+    nogood& f = ida_failure[depth];
+    f.bound = std::min(f.bound, child_failure.bound);
+    if (!learn_nogoods) {
+        return;
+    }
+    if (!explained) {
+        ida_explained[depth] = false;
+        return;
+    }
+    cell* branched = cells[ida_stack[depth].level];
+    f.left = f.left.union_with(child_failure.left);
+    f.right = f.right.union_with(child_failure.right);
+    f.left.clear(branched->label);
+    f.right.clear(branched->label);
+}
+
+tt_key traverser::key_of(a3::partition& p, int level) {
+    tt_key k;
+    k.level = level;
+    k.vl_area = p.vl_area;
+    k.vr_area = p.vr_area;
+    k.left_nets = p.vl_nets.intersection_with(p.uncut_nets);
+    k.right_nets = p.vr_nets.intersection_with(p.uncut_nets);
+    if (prune_symmetry) {
+        k.symmetric_right = p.vr_cells.intersection_with(lex_cells);
+    }
+    return k;
+}
+
+bool traverser::ida_next_pass() {
+    if (!ida_started) {
+        ida_restart(prune_lb ? root->p.lb() : root->p.cost());
+        return true;
+    }
+    spdlog::info("IDA pass at threshold {}: {} nodes", ida_threshold, ida_pass_nodes);
+    if (ida_next_threshold == INT_MAX || ida_next_threshold >= (*best)->cost()) {
+        return false;
+    }
+    ida_restart(ida_next_threshold);
+    return true;
+}
+
+pnode* traverser::ida_step() {
+    while (true) {
+        if (ida_depth < 0 && !ida_next_pass()) {
+            return nullptr;
+        }
+
+        pnode* pn = &ida_stack[ida_depth];
+        int& branch = ida_branch[ida_depth];
+
+        if (branch == IDA_UNVISITED) {
+            visited_nodes++;
+            ida_pass_nodes++;
+            ida_failure[ida_depth] = {bitfield(), bitfield(), INT_MAX};
+            ida_explained[ida_depth] = true;
+            if (pn->p.unassigned_cells.size == 0) {
+                spdlog::debug("leaf node: {}", pn->p.cost());
+                if (pn->p.cost() < (*best)->cost()) {
+                    if (ida_incumbent == nullptr) {
+                        ida_incumbent = new a3::partition();
+                    }
+                    *ida_incumbent = pn->p;
+                    spdlog::info("found new best! ({} < {})", pn->p.cost(), (*best)->cost());
+                    *best = ida_incumbent;
+                }
+                if (ida_depth > 0) {
+                    nogood ng = {bitfield(), bitfield(), pn->p.cost()};
+                    if (learn_nogoods) {
+                        explain(pn->p, pn->p.cost(), ng);
+                    }
+                    ida_note_failure(ida_depth - 1, ng, true);
                 }
+                ida_depth--;
             } else {
-                spdlog::debug("pruning: imbalance");
+                branch = 0;
             }
+            return pn;
+        }
 
-            // explore putting it on the right
-            if ( (pn->level > 0 || !prune_symmetry) && (!prune_imbalance || (pn->p.vr_cells.size < cells.size()/2 ))) {
-                pn->right = new pnode();
-                
-                // UI drawing related
-                pn->right->level = pn->level + 1;
-                pn->right->y = pn->y + 64.0*PNODE_DIAMETER;
-                int levels_to_leaf = cells.size() - pn->level -2;
-                pn->right->x = pn->x + PNODE_DIAMETER*(2<<levels_to_leaf);
-
-                pn->right->parent = pn;
-                pn->right->p = a3::partition(pn->p);
-                pn->right->p.assign_right(pn->p.next_unassigned(cells));
-                if (!prune_lb || !prune(&pn->right->p, best)) {
-                    q_bfs.push(pn->right);
-                } else {
-                    delete pn->right;
-                    pn->right = nullptr;
+        // both children tried, back up a level
+        if (branch > 1) {
+            nogood& ng = ida_failure[ida_depth];
+            if (learn_nogoods && ida_explained[ida_depth] && (ng.bound >= (*best)->cost() || ng.bound > ida_threshold)) {
+                learn(ng);
+            }
+            if (ida_depth > 0) {
+                if (tt != nullptr) {
+                    tt->store(key_of(pn->p, pn->level), ng.bound == INT_MAX ? INT_MAX : ng.bound - pn->p.cost());
                 }
-            } else {
-                spdlog::debug("pruning: imbalance");
+                ida_note_failure(ida_depth - 1, ng, ida_explained[ida_depth]);
             }
-        } else { 
-            spdlog::debug("leaf node: {}", pn->p.cost());
-            int tcost = pn->p.cost();
-            int bcost = (*best)->cost();
-            prune(&pn->p, best);
+            ida_depth--;
+            continue;
         }
-        rc = pn;
-    } 
-    return rc;
+
+        bool go_left = (branch == 0);
+        branch++;
+
+        cell* c = pn->p.next_unassigned(cells);
+        if (!(go_left ? may_go_left(pn) : may_go_right(pn))) {
+            ida_explained[ida_depth] = false;
+            continue;
+        }
+        if (prune_imbalance && !(go_left ? pn->p.fits_left(c) : pn->p.fits_right(c))) {
+            // whatever is already on that side leaves no room
+            nogood full = {bitfield(), bitfield(), INT_MAX};
+            if (learn_nogoods) {
+                (go_left ? full.left : full.right) =
+                    go_left ? without(pn->p.vl_cells, circ->get_fixed_left()) : without(pn->p.vr_cells, circ->get_fixed_right());
+            }
+            ida_note_failure(ida_depth, full, true);
+            continue;
+        }
+
+        pnode* child = &ida_stack[ida_depth + 1];
+        child->level = pn->level + 1;
+        child->p = pn->p;
+        go_left ? child->p.assign_left(c) : child->p.assign_right(c);
+
+        int f = prune_lb ? child->p.lb() : child->p.cost();
+        int added;
+        if (tt != nullptr && f < (*best)->cost() && f <= ida_threshold && tt->lookup(key_of(child->p, child->level), added)) {
+            f = std::max(f, added == INT_MAX ? INT_MAX : child->p.cost() + added);
+        }
+        nogood ng = {bitfield(), bitfield(), f};
+        bool known = (f < (*best)->cost() && f <= ida_threshold) &&
+            known_failure(child->p, c, std::min((*best)->cost(), ida_threshold + 1), ng);
+        if (known) {
+            f = ng.bound;
+        } else if (learn_nogoods && (f >= (*best)->cost() || f > ida_threshold)) {
+            if (explain(child->p, f, ng)) {
+                learn(ng);
+            }
+        }
+        if (f >= (*best)->cost() || f > ida_threshold) {
+            ida_note_failure(ida_depth, ng, true);
+            if (f < (*best)->cost()) {
+                ida_next_threshold = std::min(ida_next_threshold, f);
+            }
+            continue;
+        }
+
+        ida_depth++;
+        ida_branch[ida_depth] = IDA_UNVISITED;
+    }
 }
 
 traverser::traverser(circuit* c, a3::partition** _best, bool (*prune_fn)(a3::partition* test, a3::partition** best)) {
     bfs = false;
-    cells = vector<cell*>(c->get_cells());
+    ida = false;
     circ = c;
+    for(auto cl : c->get_cells()) {
+        if (!c->is_fixed(cl->label)) {
+            cells.push_back(cl);
+        }
+    }
     std::sort(cells.begin(), cells.end(), cell_sort_most_nets);
+
+    // pinned cells or uneven capacities break the left/right mirror symmetry
+    symmetric = (c->get_n_fixed() == 0) && (c->get_left_capacity() == c->get_right_capacity());
+
+    position = std::vector<int>(64*BITFIELD_WORDS, -1);
+    for(size_t i = 0; i < cells.size(); ++i) {
+        position[cells[i]->label] = i;
+    }
+    auto by_position = [this](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+        return position[a.first] < position[b.first];
+    };
+    // an interchangeable group is a chain of swaps between neighbours in
+    // branching order
+    for(auto g : c->get_cell_groups()) {
+        std::sort(g.begin(), g.end(), [this](int a, int b) { return position[a] < position[b]; });
+        for(size_t i = 1; i < g.size(); ++i) {
+            lex_pairs.push_back({{g[i-1], g[i]}, {g[i], g[i-1]}});
+        }
+    }
+    for(auto& perm : c->get_automorphisms()) {
+        std::vector<std::pair<int, int>> moved;
+        for(auto cl : cells) {
+            if (perm[cl->label] != cl->label) {
+                moved.push_back({cl->label, perm[cl->label]});
+            }
+        }
+        std::sort(moved.begin(), moved.end(), by_position);
+        lex_pairs.push_back(moved);
+    }
+    lex_pairs_of = std::vector<std::vector<int>>(64*BITFIELD_WORDS);
+    for(size_t g = 0; g < lex_pairs.size(); ++g) {
+        for(auto& pr : lex_pairs[g]) {
+            lex_pairs_of[pr.first].push_back(g);
+            lex_cells.set(pr.first);
+            lex_cells.set(pr.second);
+        }
+    }
     cur_cell = cells.begin();
     visited_nodes = 0;
 
     // only turn this off for test mode
     prune_imbalance = true;
     prune_lb = true;
+    prune_symmetry = false;
+    learn_nogoods = false;
+    nogood_limit = 100000;
+    nogoods = nullptr;
+    tt_megabytes = 0;
+    tt = nullptr;
+    log_progress = false;
+    deepest = -1;
+    logged_deepest = -1;
 
     root = new pnode();
-    root->parent = nullptr;
     root->level = 0;
-    root->y = PNODE_DIAMETER/2.0;
-    root->x = circ->get_display_width()/2.0;
+    retired = nullptr;
+    incumbent_node = nullptr;
     root->p = a3::partition(c);
+    root->p.assign_fixed();
+    if (!root->p.is_balanced()) {
+        spdlog::warn("fixed cells alone exceed the side capacity");
+    }
 
     q_bfs = queue<pnode*>();
     q_bfs.push(root);
+    pq = pnode_queue(TIES_DEEPEST, cells.size());
     pq.push(root);
 
     prune = prune_fn;
     best = _best;
 
+    ida_stack = vector<pnode>(cells.size() + 1);
+    ida_branch = vector<int>(cells.size() + 1, IDA_UNVISITED);
+    ida_failure = vector<nogood>(cells.size() + 1);
+    ida_explained = vector<bool>(cells.size() + 1, false);
+    ida_depth = IDA_UNVISITED;
+    ida_started = false;
+    ida_threshold = 0;
+    ida_next_threshold = INT_MAX;
+    ida_pass_nodes = 0;
+    ida_incumbent = nullptr;
 }
 
-traverser::~traverser() {
-    del_tree(root);
-}
-
-void del_tree(pnode* root) {
-    stack<pnode*> s;
-    s.push(root);
-    while(!s.empty()) {
-        pnode* pn = s.top();
-        if (pn != nullptr) {
-            if (pn->left != nullptr or pn->right != nullptr) {
-                if (pn->left != nullptr) {
-                    s.push(pn->left);
-                } 
-                if (pn->right != nullptr) {
-                    s.push(pn->right);
-                }
-            } else {
-                if (pn->parent != nullptr) {
-                    if (pn->parent->left == pn) {
-                        pn->parent->left = nullptr;
-                    } else if (pn->parent->right == pn) {
-                        pn->parent->right = nullptr;
-                    } 
-                }
-                s.pop();
-                spdlog::info("I AM DELETING {}", (void*)pn);
-                delete pn;
-            }
+/****
+*
+* checkpointing
+*
+* the frontier is written out as compact cell assignments (the rest of a
+* partition is rebuilt from them on load) along with each node's cost,
+* the incumbent and the node counter.
+*
+****/
+
+static const char* CHECKPOINT_MAGIC = "a3-checkpoint";
+static const int CHECKPOINT_VERSION = 2;
+
+static void write_bitfield(std::ostream& os, bitfield& b) {
+    for(int i = 0; i < BITFIELD_WORDS; ++i) {
+        os << " " << std::hex << b.bits[i] << std::dec;
+    }
+}
+
+static bool read_bitfield(std::istream& is, bitfield& b) {
+    b = bitfield();
+    for(int i = 0; i < BITFIELD_WORDS; ++i) {
+        if (!(is >> std::hex >> b.bits[i] >> std::dec)) {
+            return false;
         }
     }
+    b.recount();
+    return true;
 }
 
-bitfield a3::partition::num_guaranteed_cut_nets() {
-    // foreach uncut net - if the number of unassigned cells on it is > half of remaining, its a guaranteed cut
-    bitfield ret;
-    int cut_net_count = 0;
-    map<int,int> net_cell_counts;
+static void write_pnode(std::ostream& os, pnode* pn) {
+    os << pn->level << " " << pn->p.cost();
+    write_bitfield(os, pn->p.vl_cells);
+    write_bitfield(os, pn->p.vr_cells);
+    os << "\n";
+}
 
-    for(auto n : uncut_nets.to_vec()) {
-        net_cell_counts[n] = 0;
+// nodes waiting to be expanded; for ida, the current path
+step_summary traverser::summarize(step_summary s) {
+    s.deepest = deepest;
+    s.best_cost = (*best)->cost();
+    if (log_progress && deepest > logged_deepest) {
+        spdlog::info("at level {}/{}.  Visited nodes: {}", deepest + 1, circ->get_n_cells(), visited_nodes);
+        logged_deepest = deepest;
     }
+    return s;
+}
 
-    int min_size = circ->get_n_cells()/2;
+// the clock is only read between batches
+step_summary traverser::run_until(std::chrono::steady_clock::time_point deadline) {
+    step_summary total;
+    do {
+        step_summary s = step(STEP_BATCH_NODES);
+        s.nodes += total.nodes;
+        total = s;
+    } while (!total.done && std::chrono::steady_clock::now() < deadline);
+    return total;
+}
 
-    for(auto nl: uncut_nets.to_vec()) {
-       for (auto cl: circ->get_net(nl)->cell_labels.to_vec()) {
-           if (unassigned_cells.get(cl)) {
-                net_cell_counts[nl]++;
-           }
-       } 
+step_summary traverser::run_to_completion() {
+    step_summary total;
+    do {
+        step_summary s = step(STEP_BATCH_NODES);
+        s.nodes += total.nodes;
+        total = s;
+    } while (!total.done);
+    return total;
+}
+
+size_t traverser::frontier_size() {
+    return ida ? ida_depth + 1 : (bfs ? q_bfs.size() : pq.size());
+}
+
+// re-files the frontier under the new order
+void traverser::set_ties(tie_break ties) {
+    std::vector<pnode*> frontier = pq.nodes();
+    pq = pnode_queue(ties, cells.size());
+    for(auto pn : frontier) {
+        pq.push(pn);
     }
+}
 
-    for (auto n : uncut_nets.to_vec()) {
-        if (net_cell_counts[n] > min_size) {
-            cut_net_count++;
-            ret.set(n);
+bool traverser::save_checkpoint(std::string file) {
+    // write to a temporary and rename over the old checkpoint, so being
+    // killed mid-write never leaves us without a usable file
+    std::string tmp = file + ".tmp";
+    std::ofstream os(tmp);
+    if (!os.is_open()) {
+        spdlog::error("Could not open {} for checkpointing", tmp);
+        return false;
+    }
+
+    os << CHECKPOINT_MAGIC << " " << CHECKPOINT_VERSION << "\n";
+    os << "signature " << std::hex << circ->signature() << std::dec << "\n";
+    os << "mode " << (ida ? "ida" : (bfs ? "bfs" : "lb")) << "\n";
+    os << "ties " << tie_break_name(pq.get_ties()) << "\n";
+    os << "visited " << visited_nodes << "\n";
+    os << "best " << (*best)->cost();
+    write_bitfield(os, (*best)->vl_cells);
+    write_bitfield(os, (*best)->vr_cells);
+    os << "\n";
+
+    if (ida) {
+        // the in-place path is cheap to rebuild, so just restart the pass
+        // that was in progress
+        os << "threshold " << ida_threshold << "\n";
+        os << "frontier 0\n";
+    } else if (bfs) {
+        std::queue<pnode*> q = q_bfs;
+        os << "frontier " << q.size() << "\n";
+        while (!q.empty()) {
+            write_pnode(os, q.front());
+            q.pop();
+        }
+    } else {
+        // pop order, so a resumed search pops nodes in the same order
+        os << "frontier " << pq.size() << "\n";
+        for(auto pn : pq.nodes()) {
+            write_pnode(os, pn);
         }
     }
+    os.close();
+
+    if (os.fail() || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        spdlog::error("Failed writing checkpoint {}", file);
+        return false;
+    }
+    spdlog::info("Checkpointed {} frontier nodes to {}", frontier_size(), file);
+    return true;
+}
+
+bool traverser::load_checkpoint(std::string file) {
+    std::ifstream is(file);
+    if (!is.is_open()) {
+        spdlog::error("Could not open checkpoint {}", file);
+        return false;
+    }
+
+    std::string tok, mode, ties_name;
+    tie_break ties;
+    int version = 0;
+    unsigned long long sig = 0;
+    unsigned long long visited = 0;
+    int best_cost = 0;
+    int threshold = 0;
+    size_t n_frontier = 0;
+    bitfield l, r;
+
+    if (!(is >> tok >> version) || tok != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION) {
+        spdlog::error("{} is not a version {} checkpoint", file, CHECKPOINT_VERSION);
+        return false;
+    }
+    if (!(is >> tok >> std::hex >> sig >> std::dec) || sig != circ->signature()) {
+        spdlog::error("Checkpoint {} was written for a different circuit", file);
+        return false;
+    }
+    if (!(is >> tok >> mode >> tok >> ties_name >> tok >> visited) || !parse_tie_break(ties_name, ties)) {
+        spdlog::error("Malformed checkpoint header in {}", file);
+        return false;
+    }
+    if (!(is >> tok >> best_cost) || !read_bitfield(is, l) || !read_bitfield(is, r)) {
+        spdlog::error("Malformed incumbent in {}", file);
+        return false;
+    }
+
+    a3::partition* incumbent = new a3::partition(circ);
+    incumbent->assign_from(l, r);
+    if (best_cost == circ->get_total_weight() + 1) {
+        // no balanced solution yet, so the incumbent carries the cost any
+        // balanced leaf beats rather than its own cut
+        incumbent->cut_weight = best_cost;
+    } else if (incumbent->cost() != best_cost) {
+        spdlog::error("Checkpoint incumbent cost mismatch ({} vs {})", incumbent->cost(), best_cost);
+        delete incumbent;
+        return false;
+    }
+
+    if (mode == "ida" && !(is >> tok >> threshold)) {
+        spdlog::error("Malformed threshold in {}", file);
+        delete incumbent;
+        return false;
+    }
 
+    if (!(is >> tok >> n_frontier)) {
+        spdlog::error("Malformed frontier in {}", file);
+        delete incumbent;
+        return false;
+    }
+
+    std::vector<pnode*> frontier;
+    frontier.reserve(n_frontier);
+    for(size_t i = 0; i < n_frontier; ++i) {
+        int level, cost;
+        if (!(is >> level >> cost) || !read_bitfield(is, l) || !read_bitfield(is, r)) {
+            spdlog::error("Truncated frontier in {} ({} of {} nodes)", file, i, n_frontier);
+            for(auto pn : frontier) {
+                delete pn;
+            }
+            delete incumbent;
+            return false;
+        }
+        pnode* pn = new pnode();
+        pn->level = level;
+        pn->p = a3::partition(circ);
+        pn->p.assign_from(l, r);
+        frontier.push_back(pn);
+    }
+
+    bool ckpt_bfs = (mode == "bfs");
+    bool ckpt_ida = (mode == "ida");
+    if (ckpt_bfs != bfs || ckpt_ida != ida) {
+        spdlog::warn("Checkpoint was taken in {} mode, continuing in that mode", mode);
+        bfs = ckpt_bfs;
+        ida = ckpt_ida;
+    }
+    if (ida) {
+        ida_restart(threshold);
+    }
+
+    if (ties != pq.get_ties()) {
+        spdlog::warn("Checkpoint breaks ties {}, continuing that way", ties_name);
+    }
+
+    free_frontier();
+    q_bfs = std::queue<pnode*>();
+    pq = pnode_queue(ties, cells.size());
+    if (bfs) {
+        for(auto pn : frontier) {
+            q_bfs.push(pn);
+        }
+    } else {
+        pq.restore(frontier);
+    }
+    *best = incumbent;
+    visited_nodes = visited;
+
+    spdlog::info("Resumed {} frontier nodes, incumbent cost {}, {} nodes visited", frontier.size(), best_cost, visited);
+    return true;
+}
+
+traverser::~traverser() {
+    if (retired != root) {
+        delete retired;
+    }
+    free_frontier();
+    delete incumbent_node;
+    delete root;
+    delete nogoods;
+    delete tt;
+}
+
+bitfield a3::partition::num_guaranteed_cut_nets() {
+    // foreach uncut net - if its unassigned cells cant all fit on the side(s) it
+    // could still stay uncut on, its a guaranteed cut
+    bitfield ret;
+
+    int room_left = circ->get_left_capacity() - vl_area;
+    int room_right = circ->get_right_capacity() - vr_area;
+    a3::guaranteed_cuts(net_free_area, net_span, uncut_nets,
+            vl_nets, vr_nets, room_left, room_right, ret);
     return ret;
 }
 
@@ -483,29 +1459,32 @@ bitfield a3::partition::one_partition_full_cut_nets() {
     bitfield ret;
     bitfield *side = nullptr;
 
-    if (vl_cells.size == circ->get_n_cells()/2) {
+    if (unassigned_cells.size == 0) {
+        return ret;
+    }
+
+    // full means none of the remaining cells fit
+    int min_area = min_unassigned_area();
+
+    if (vl_area + min_area > circ->get_left_capacity()) {
         side = &vl_nets;
-    } else if (vr_cells.size == circ->get_n_cells()/2) {
+    } else if (vr_area + min_area > circ->get_right_capacity()) {
         side = &vr_nets;
     }
 
     if (nullptr != side) {
-        // check if unassigned cells have nets on the 
-        // full side.  If so, they will be cut
-        for(auto nl : side->to_vec()) {
-            for (auto cl: unassigned_cells.to_vec()) {
-                if (circ->get_net(nl)->cell_labels.get(cl)) {
-                    ret.set(nl);
-                    break; // can only cut once
-                }
-            }
-        }
+        // nets on the full side with a free cell left will be cut
+        // (nets that are already cut are counted by cost())
+        bitfield open_nets = side->intersection_with(uncut_nets);
+        a3::nonzero(net_free_pins, net_span, open_nets, ret);
     }
 
     return ret;
 }
 
-int a3::partition::min_number_anchored_nets_cut() {
+// nets in already_counted are left out, so this can be added to
+// another bound without counting a net twice
+int a3::partition::min_number_anchored_nets_cut(bitfield* already_counted) {
     int result = 0;
 
     // if an unassigned cell has nets already assigned to both left and right,
@@ -513,24 +1492,22 @@ int a3::partition::min_number_anchored_nets_cut() {
     // one of these sets is guaranteed to be cut.
     // we dont know which one, though
     // this is mutually exclusive with the half full scenario, i think??
-    for (auto cl : unassigned_cells.to_vec()) {
-        cell* c = circ->get_cell(cl); 
-        vector<int> myleftnets, myrightnets;
-        for (auto nl : c->net_labels.to_vec()) {
-            int num_added=0;
-            if (vl_nets.get(nl) && !vr_nets.get(nl)) {
-                myleftnets.push_back(nl);
-                num_added++;
-            }
-            if (vr_nets.get(nl) && !vl_nets.get(nl)) {
-                myrightnets.push_back(nl);
-                num_added++;
-            }
-            if (num_added == 2){ 
-                spdlog::warn("net {} should have been cut...", nl);
-            }
+    bitfield torn;
+    a3::both_nonzero(anchored_left, anchored_right, cell_span, unassigned_cells, torn);
+    torn.for_each([&](int cl) {
+        int left_weight = anchored_left[cl], right_weight = anchored_right[cl];
+        if (already_counted != nullptr) {
+            bitfield counted = circ->get_cell(cl)->net_labels.intersection_with(*already_counted);
+            counted.for_each([&](int nl) {
+                if (vl_nets.get(nl) && !vr_nets.get(nl)) {
+                    left_weight -= circ->get_net(nl)->weight;
+                }
+                if (vr_nets.get(nl) && !vl_nets.get(nl)) {
+                    right_weight -= circ->get_net(nl)->weight;
+                }
+            });
         }
-        if (myleftnets.size() > 0 && myrightnets.size() > 0) {
+        if (left_weight > 0 && right_weight > 0) {
 	        // we cant really combine sets here, 
             // what if one node's smaller set and another nodes smaller set
             // have zero overlap
@@ -538,19 +1515,9 @@ int a3::partition::min_number_anchored_nets_cut() {
             // but, the larger sets have total overlap	
             // its hard to say which will pan out...
             // so the best we can do, is take the maximal minimum set
-            //
-            // the largest of the 'smallest' sets is the 
-            if (myleftnets.size() < myrightnets.size()) {
-                if (myleftnets.size() > result) {
-                    result = myleftnets.size();
-                }
-            } else {
-                if (myrightnets.size() > result) {
-                    result = myrightnets.size();
-                }
-            }
+            result = std::max(result, std::min(left_weight, right_weight));
         }
-    }
+    });
     
     return result;
 }
@@ -559,19 +1526,8 @@ int a3::partition::min_number_anchored_nets_cut() {
 bool prune_basic_cost(a3::partition* test, a3::partition** best) {
     bool ret = false;
 
-    // these are different measures, there can be overlap, so cant apply both
-    bitfield guaranteed_cuts = test->num_guaranteed_cut_nets();
-    bitfield full_partition_cuts = test->one_partition_full_cut_nets();
-    int anchored_cuts = 0;
-
-    if (full_partition_cuts.size == 0) {
-        anchored_cuts = test->min_number_anchored_nets_cut();
-    }
-
-    int min_added_cuts = guaranteed_cuts.union_with(full_partition_cuts).size + anchored_cuts;
-
     spdlog::debug("\t({} vs {}) [{}]", test->cost(), (*best)->cost(), test->unassigned_cells.size);
-    int total_cost = min_added_cuts + test->cost();
+    int total_cost = test->lb();
     if (total_cost < (*best)->cost()) {
         if (test->unassigned_cells.size == 0) {
             spdlog::info("found new best! ({} < {}) {}", test->cost(), (*best)->cost(), (void*)test);
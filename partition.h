@@ -2,6 +2,9 @@
 #define __PARTITION_H__
 #include "circuit.h"
 #include "bitfield.h"
+#include "nogood.h"
+#include "transposition.h"
+#include "kernels.h"
 #include "spdlog/spdlog.h"
 #include "spdlog/fmt/bundled/format.h"
 #include <queue>
@@ -9,9 +12,14 @@
 #include <vector>
 #include <stack>
 #include <algorithm>
+#include <chrono>
 
 
 const double PNODE_DIAMETER = 10.0;
+const double PNODE_LEVEL_SPACING = 64.0*PNODE_DIAMETER;
+// the drawn tree is as wide as a full tree of this many levels at most;
+// deeper levels are only ever seen as density bands
+const int MAX_DISPLAY_LEVELS = 16;
 
 class cell;
 class circuit;
@@ -28,73 +36,253 @@ namespace a3 {
         bitfield unassigned_cells;
         bitfield uncut_nets;
         bitfield cut_nets;
+        int cut_weight;
+        int vl_area;
+        int vr_area;
+        // bound state kept up to date by assign: per net, the area and number
+        // of its cells still free; per cell, the weight of its uncut nets
+        // that already have pins on the left only / right only.
+        // fixed size so copying a node does not allocate; only the first
+        // net_span / cell_span entries (the labels in use, padded for the
+        // kernels) are kept and copied
+        int net_free_area[kernel_padded(64*BITFIELD_WORDS)];
+        int net_free_pins[kernel_padded(64*BITFIELD_WORDS)];
+        int anchored_left[kernel_padded(64*BITFIELD_WORDS)];
+        int anchored_right[kernel_padded(64*BITFIELD_WORDS)];
+        int net_span;
+        int cell_span;
 
         partition();
         partition(a3::partition*);
-        int min_number_anchored_nets_cut();
+        partition(const a3::partition&);
+        partition& operator=(const a3::partition&);
+        int min_number_anchored_nets_cut(bitfield* already_counted = nullptr);
         bitfield num_guaranteed_cut_nets();
         bitfield one_partition_full_cut_nets();
 
-        cell* next_unassigned(std::vector<cell*>);
+        cell* next_unassigned(const std::vector<cell*>&);
         int cost();
-        void update_cut_nets();
         partition(circuit*);
         int calculate_cut_set();
         void print_cut_nets(void);
         void assign_left(cell* c);
         void assign_right(cell* c);
+        void assign(cell* c, bool right);
+        void assign_from(bitfield& left, bitfield& right);
+        void assign_fixed();
+        bool fits_left(cell* c);
+        bool fits_right(cell* c);
+        bool is_balanced();
+        int min_unassigned_area();
         int lb();
         void initial_solution();
+        // the greedy fill and its refinement, without the random restarts
+        void initial_solution_greedy();
         void initial_solution_random();
         void initial_solution_heur1();
+        void refine();
         std::string to_string();
         bitfield make_left_supercell();
         bitfield make_right_supercell();
     };
 }
 
+// a search node holds only what the search reads.  where it is drawn is
+// worked out from p by traverser::tree_x, for the nodes that get drawn
 struct pnode {
     a3::partition p;
-    double x;
-    double y;
     int level;
-    pnode* parent;
-    pnode* left;
-    pnode* right;
     pnode();
 };
 
-class pnode_cut_compare {
+// how best-first search orders nodes of equal cost
+enum tie_break {
+    TIES_LIFO,      // newest first, so the search dives like depth first
+    TIES_FIFO,      // oldest first
+    TIES_DEEPEST    // deepest level first, newest among those
+};
+
+// the most keys the best-first frontier keeps a bucket for at once
+const size_t PNODE_QUEUE_WINDOW = 1 << 16;
+
+// best-first frontier as a bucket queue.  costs are integers, so there is
+// one bucket per key and the lowest non-empty one is popped, in O(1)
+// amortised instead of a heap's O(log n) pointer chasing.  buckets cover a
+// window of keys from the lowest live one; keys past it, which heavily
+// weighted nets make common, wait in an ordered map until the window
+// reaches them.
+// nodes() lists the frontier in pop order; checkpoints save that, and
+// restore() gives a resumed search exactly the same order back
+class pnode_queue {
+    struct bucket {
+        std::vector<pnode*> nodes;
+        size_t head;    // fifo pops from here
+    };
+    std::vector<bucket> buckets;    // keys base, base + 1, ...
+    std::map<size_t, bucket> far;   // keys from base + PNODE_QUEUE_WINDOW on
+    size_t base;
+    size_t first;       // no bucket below this one holds a node
+    size_t count;
+    size_t levels;
+    tie_break ties;
+    size_t key(pnode* pn);
+    void rebase(size_t new_base);
     public:
-        bool operator() (pnode* a, pnode* b) {
-            return a->p.cut_nets.size > b->p.cut_nets.size;
-        } 
+        pnode_queue(tie_break ties = TIES_LIFO, size_t levels = 0);
+        void push(pnode* pn);
+        pnode* top();
+        void pop();
+        bool empty() { return count == 0; }
+        size_t size() { return count; }
+        tie_break get_ties() { return ties; }
+        std::vector<pnode*> nodes();
+        void restore(const std::vector<pnode*>& in_pop_order);
+};
+
+// what a call to one of the traverser's run methods did
+struct step_summary {
+    unsigned long long nodes = 0;   // expanded by this call
+    int deepest = -1;               // deepest level expanded so far
+    int best_cost = 0;
+    bool done = false;              // nothing is left to expand
+};
+
+// what the frontier searches are compiled for, as template arguments of
+// traverser::expand.  RUNTIME reads the flags and calls the prune function
+// through its pointer instead
+enum step_policy {
+    POLICY_IMBALANCE = 1,
+    POLICY_SYMMETRY = 2,
+    POLICY_LB = 4,
+    POLICY_RUNTIME = 8,
 };
 
+// the run methods poll the clock and log progress once per this many nodes
+const unsigned long long STEP_BATCH_NODES = 4096;
+
 class traverser {
     pnode* root;
     circuit* circ;
     std::queue<pnode*> q_bfs;
-    std::priority_queue<pnode*, std::vector<pnode*>, pnode_cut_compare> pq;
+    pnode_queue pq;
     std::vector<cell*> cells;
+    bool symmetric;
+    // symmetries as (cell, image) pairs in branching order, and which of
+    // them each cell label takes part in
+    std::vector<std::vector<std::pair<int, int>>> lex_pairs;
+    std::vector<std::vector<int>> lex_pairs_of;
+    bool lex_leader_ok(a3::partition& p, cell* c, bool right);
+    bool symmetry_allows(pnode* pn, cell* c, bool right);
+    bool may_go_left(pnode* pn);
+    bool may_go_right(pnode* pn);
+
+    // nogood learning: cells by branching position, and the store
+    std::vector<int> position;
+    nogood_store* nogoods;
+    bool explain(a3::partition& p, int target, nogood& ng);
+    void learn(nogood& ng);
+    bool known_failure(a3::partition& child, cell* c, int at_least, nogood& ng);
+    template<int POLICY> bool keep_child(a3::partition& child, cell* c);
+    template<int POLICY> bool bound_prunes(a3::partition* p);
     a3::partition** best;
     bool (*prune)(a3::partition* test, a3::partition** best);
+
+    // iterative deepening state: one node per level, reused in place
+    std::vector<pnode> ida_stack;
+    std::vector<int> ida_branch;
+    int ida_depth;
+    int ida_next_threshold;
+    unsigned long long ida_pass_nodes;
+    a3::partition* ida_incumbent;
+    bool ida_started;
+    // why the subtree under each level failed, while it is being searched
+    std::vector<nogood> ida_failure;
+    std::vector<bool> ida_explained;
+    void ida_note_failure(int depth, nogood& child_failure, bool explained);
+    // completion bounds shared between equivalent nodes.  only ida fills
+    // it: a bound is stored once a node's subtree is searched, and a
+    // frontier search never finishes a subtree at a point it could store it
+    transposition_table* tt;
+    bitfield lex_cells;
+    tt_key key_of(a3::partition& p, int level);
+    bool ida_next_pass();
+    void ida_restart(int threshold);
+    template<int POLICY, typename Q> pnode* expand(Q& frontier);
+    template<int POLICY> pnode* best_first_step();
+    template<int POLICY> pnode* breadth_first_step();
+    typedef pnode* (traverser::*step_fn)();
+    // the compiled loop matching the flags, looked up once per batch
+    step_fn frontier_step(bool breadth_first);
+    // a step's node lives until the next step; the root, which ida restarts
+    // from, and the node holding the incumbent live as long as the traverser
+    pnode* retired;
+    pnode* incumbent_node;
+    void retire();
+    void free_frontier();
+    // progress, kept per batch rather than per node
+    int deepest;
+    int logged_deepest;
+    template<typename F> step_summary steps(unsigned long long n, step_fn next, F& on_node);
+    step_summary summarize(step_summary s);
     public:
         std::vector<cell*>::iterator cur_cell;
 	bool bfs;
+        bool ida;
+        int ida_threshold;
         bool prune_imbalance;
         bool prune_symmetry;
         bool prune_lb;
-        std::vector<pnode*> pnodes;
+        bool learn_nogoods;
+        size_t nogood_limit;
+        size_t tt_megabytes;
+        bool log_progress;
         long long unsigned int visited_nodes;
         traverser(circuit* c, a3::partition** best, bool (*prune_fn)(a3::partition* test, a3::partition** best));
         ~traverser();
         pnode* bfs_step();
 	pnode* dfs_step();
+        pnode* ida_step();
+        // whichever of the three the flags ask for, n nodes at a time (or
+        // fewer, if the search ends).  on_node sees every expanded node
+        template<typename F> step_summary step(unsigned long long n, F on_node);
+        step_summary step(unsigned long long n) { return step(n, [](pnode*) {}); }
+        step_summary run_until(std::chrono::steady_clock::time_point deadline);
+        step_summary run_to_completion();
+        bool save_checkpoint(std::string file);
+        bool load_checkpoint(std::string file);
+        nogood_store* get_nogoods() { return nogoods; }
+        transposition_table* get_tt() { return tt; }
+        size_t frontier_size();
+        a3::partition* get_best() { return *best; }
+        void set_ties(tie_break ties);
+        tie_break get_ties() { return pq.get_ties(); }
+        // where the node whose right side is `right` is drawn at `level`,
+        // as a fraction of the tree's width
+        double tree_x(bitfield& right, int level);
 };
 
+template<typename F>
+step_summary traverser::steps(unsigned long long n, step_fn next, F& on_node) {
+    step_summary s;
+    for (; s.nodes < n; ++s.nodes) {
+        pnode* pn = (this->*next)();
+        if (pn == nullptr) {
+            s.done = true;
+            break;
+        }
+        deepest = std::max(deepest, pn->level);
+        on_node(pn);
+    }
+    return summarize(s);
+}
+
+template<typename F> step_summary traverser::step(unsigned long long n, F on_node) {
+    return steps(n, ida ? &traverser::ida_step : frontier_step(bfs), on_node);
+}
+
 bool cell_sort_most_nets(cell* a, cell* b);
-void del_tree(pnode* root);
+const char* tie_break_name(tie_break ties);
+bool parse_tie_break(std::string name, tie_break& ties);
 bool prune_basic_cost(a3::partition* test, a3::partition** best);
 
 #endif
@@ -9,6 +9,29 @@
 #include <string>
 #include "circuit.h"
 #include "partition.h"
+#include "components.h"
+
+// sizes of combined sets come from the words, across word boundaries
+TEST(Bitfield, word_ops) {
+    bitfield a, b;
+    for (int l : {0, 63, 64, 130, 255}) {
+        a.set(l);
+    }
+    for (int l : {63, 64, 65, 200, 255}) {
+        b.set(l);
+    }
+    bitfield u = a.union_with(b);
+    bitfield i = a.intersection_with(b);
+    ASSERT_EQ(u.size, 7);
+    ASSERT_EQ(i.size, 3);
+    ASSERT_EQ(i.to_vec(), std::vector<int>({63, 64, 255}));
+    ASSERT_EQ(u.to_vec(), std::vector<int>({0, 63, 64, 65, 130, 200, 255}));
+    a.clear(64);
+    a.clear(64);
+    ASSERT_EQ(a.size, 4);
+    ASSERT_FALSE(a.get(64));
+    ASSERT_TRUE(a.get(63));
+}
 
 TEST(Partition, test_assign) {
     circuit* c = new circuit("../data/partition_test");
@@ -57,6 +80,66 @@ bool never_prune(a3::partition* test, a3::partition** best) {
     return false;
 }
 
+// cheapest balanced cost by trying every assignment
+int brute_force_cost(circuit* c) {
+    vector<cell*> cells = c->get_cells();
+    int best = INT_MAX;
+    for (unsigned long long mask = 0; mask < (1ULL << cells.size()); ++mask) {
+        a3::partition p(c);
+        bool respects_fixed = true;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            bool right = (mask & (1ULL << i));
+            right ? p.assign_right(cells[i]) : p.assign_left(cells[i]);
+            if ((right && c->get_fixed_left().get(cells[i]->label)) ||
+                (!right && c->get_fixed_right().get(cells[i]->label))) {
+                respects_fixed = false;
+            }
+        }
+        if (respects_fixed && p.is_balanced()) {
+            best = std::min(best, p.cost());
+        }
+    }
+    return best;
+}
+
+TEST(Partition, test_weighted_cost) {
+    circuit* c = new circuit("../data/weighted_test");
+    a3::partition* p = new a3::partition(c);
+
+    p->assign_left(c->get_cell(3));
+    p->assign_right(c->get_cell(4));
+    ASSERT_EQ(p->cost(), 5); // net 4 has weight 5
+    ASSERT_EQ(p->cut_nets.size, 1);
+
+    p->assign_right(c->get_cell(1));
+    ASSERT_EQ(p->cost(), 6); // plus net 2
+
+    ASSERT_EQ(p->vr_area, 3);
+    ASSERT_TRUE(p->fits_right(c->get_cell(2)));
+    ASSERT_FALSE(p->fits_right(c->get_cell(6)));
+
+    delete p;
+    delete c;
+}
+
+TEST(Tree, weighted_area_balance) {
+    circuit* c = new circuit("../data/weighted_test");
+    spdlog::set_level(spdlog::level::info);
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    p->initial_solution();
+    ASSERT_TRUE(p->is_balanced());
+
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    while (t->dfs_step() != nullptr) {}
+
+    ASSERT_EQ((*best)->unassigned_cells.size, 0);
+    ASSERT_TRUE((*best)->is_balanced());
+    ASSERT_EQ((*best)->cost(), brute_force_cost(c));
+
+    delete c;
+}
+
 TEST(Tree, bfs) {
     circuit* c = new circuit("../data/partition_test");
     a3::partition* p = new a3::partition(c);
@@ -154,6 +237,279 @@ TEST(Tree, bfs_prune_imbalance) {
     delete c;
 }
 
+TEST(Tree, checkpoint_resume) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+
+    // reference: run to completion in one go
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    p->initial_solution();
+    a3::partition* init = p;
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+    while (t->dfs_step() != nullptr) {}
+    int fresh_cost = (*best)->cost();
+    unsigned long long fresh_visited = t->visited_nodes;
+
+    // interrupted run: same incumbent, stop partway and checkpoint
+    a3::partition* p2 = init;
+    a3::partition** best2 = &p2;
+    traverser* t2 = new traverser(c, best2, prune_basic_cost);
+    t2->prune_symmetry = true;
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_NE(t2->dfs_step(), nullptr);
+    }
+    ASSERT_TRUE(t2->save_checkpoint("checkpoint_test.ckpt"));
+
+    a3::partition* p3 = new a3::partition(c);
+    a3::partition** best3 = &p3;
+    traverser* t3 = new traverser(c, best3, prune_basic_cost);
+    t3->prune_symmetry = true;
+    ASSERT_TRUE(t3->load_checkpoint("checkpoint_test.ckpt"));
+    ASSERT_EQ(t3->visited_nodes, 20);
+    ASSERT_EQ((*best3)->cost(), (*best2)->cost());
+    while (t3->dfs_step() != nullptr) {}
+
+    ASSERT_EQ((*best3)->cost(), fresh_cost);
+    ASSERT_EQ((*best3)->unassigned_cells.size, 0);
+    ASSERT_EQ(t3->visited_nodes, fresh_visited);
+
+    delete c;
+}
+
+// before the first balanced leaf the incumbent is the unbalanced start,
+// which costs more than any real cut
+TEST(Tree, checkpoint_resume_without_balanced_incumbent) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+    int sentinel = c->get_total_weight() + 1;
+
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    p->cut_weight = sentinel;
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+    while (t->dfs_step() != nullptr) {}
+
+    a3::partition* p2 = new a3::partition(c);
+    a3::partition** best2 = &p2;
+    p2->cut_weight = sentinel;
+    traverser* t2 = new traverser(c, best2, prune_basic_cost);
+    t2->prune_symmetry = true;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_NE(t2->dfs_step(), nullptr);
+    }
+    ASSERT_EQ((*best2)->cost(), sentinel);
+    ASSERT_TRUE(t2->save_checkpoint("checkpoint_unbalanced.ckpt"));
+
+    a3::partition* p3 = new a3::partition(c);
+    a3::partition** best3 = &p3;
+    traverser* t3 = new traverser(c, best3, prune_basic_cost);
+    t3->prune_symmetry = true;
+    ASSERT_TRUE(t3->load_checkpoint("checkpoint_unbalanced.ckpt"));
+    ASSERT_EQ((*best3)->cost(), sentinel);
+    while (t3->dfs_step() != nullptr) {}
+    ASSERT_EQ((*best3)->cost(), (*best)->cost());
+    ASSERT_EQ(t3->visited_nodes, t->visited_nodes);
+
+    delete t;
+    delete t2;
+    delete t3;
+    delete c;
+}
+
+// the batched entry points walk the same tree as single steps, in every mode
+TEST(Tree, batched_steps) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+
+    a3::partition* init = new a3::partition(c);
+    init->initial_solution();
+
+    for (int mode = 0; mode < 3; ++mode) {
+        a3::partition* p = init;
+        a3::partition** best = &p;
+        traverser* t = new traverser(c, best, prune_basic_cost);
+        t->prune_symmetry = true;
+        t->bfs = mode == 1;
+        t->ida = mode == 2;
+        unsigned long long single = 0;
+        while ((t->ida ? t->ida_step() : (t->bfs ? t->bfs_step() : t->dfs_step())) != nullptr) {
+            single++;
+        }
+        int cost = (*best)->cost();
+
+        a3::partition* p2 = init;
+        a3::partition** best2 = &p2;
+        traverser* t2 = new traverser(c, best2, prune_basic_cost);
+        t2->prune_symmetry = true;
+        t2->bfs = t->bfs;
+        t2->ida = t->ida;
+        unsigned long long seen = 0;
+        int deepest = -1;
+        step_summary s = t2->step(10, [&](pnode* pn) { seen++; deepest = std::max(deepest, pn->level); });
+        ASSERT_EQ(s.nodes, 10);
+        ASSERT_EQ(seen, 10);
+        ASSERT_EQ(s.deepest, deepest);
+        ASSERT_FALSE(s.done);
+        // a deadline already past still runs one batch
+        s = t2->run_until(std::chrono::steady_clock::now());
+        ASSERT_EQ(s.nodes, std::min(STEP_BATCH_NODES, single - 10));
+        s = t2->run_to_completion();
+        ASSERT_TRUE(s.done);
+        ASSERT_EQ(t2->visited_nodes, t->visited_nodes);
+        ASSERT_EQ(s.best_cost, cost);
+        ASSERT_EQ(s.deepest, c->get_n_cells());
+        ASSERT_TRUE(t2->step(10).done);
+        delete t;
+        delete t2;
+    }
+    delete c;
+}
+
+static unsigned long long counted_prunes = 0;
+static bool counting_prune(a3::partition* test, a3::partition** best) {
+    counted_prunes++;
+    return prune_basic_cost(test, best);
+}
+
+// any prune function other than the basic one runs the loop that reads the
+// flags at run time; it has to search the same tree as the compiled ones
+TEST(Tree, runtime_policy_matches_compiled) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+    for (int flags = 0; flags < 8; ++flags) {
+        for (int bfs = 0; bfs < 2; ++bfs) {
+            unsigned long long nodes[2];
+            int cost[2];
+            for (int runtime = 0; runtime < 2; ++runtime) {
+                a3::partition* p = new a3::partition(c);
+                p->cut_weight = c->get_total_weight() + 1;
+                a3::partition** best = &p;
+                counted_prunes = 0;
+                traverser* t = new traverser(c, best, runtime ? counting_prune : prune_basic_cost);
+                t->bfs = bfs;
+                t->prune_imbalance = flags & 1;
+                t->prune_symmetry = flags & 2;
+                t->prune_lb = flags & 4;
+                t->run_to_completion();
+                nodes[runtime] = t->visited_nodes;
+                cost[runtime] = (*best)->cost();
+                if (runtime) {
+                    ASSERT_GT(counted_prunes, 0);
+                }
+                delete t;
+            }
+            ASSERT_EQ(nodes[0], nodes[1]);
+            ASSERT_EQ(cost[0], cost[1]);
+            if (flags & 1) {
+                ASSERT_EQ(cost[0], brute_force_cost(c));
+            }
+        }
+    }
+    delete c;
+}
+
+TEST(Tree, ida_matches_best_first) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+
+    a3::partition* init = new a3::partition(c);
+    init->initial_solution();
+
+    a3::partition* p = init;
+    a3::partition** best = &p;
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+    while (t->dfs_step() != nullptr) {}
+
+    a3::partition* p2 = init;
+    a3::partition** best2 = &p2;
+    traverser* t2 = new traverser(c, best2, prune_basic_cost);
+    t2->prune_symmetry = true;
+    t2->ida = true;
+    pnode* pn = t2->ida_step();
+    ASSERT_EQ(pn->level, 0);
+    while (t2->ida_step() != nullptr) {}
+
+    ASSERT_EQ((*best2)->cost(), (*best)->cost());
+    ASSERT_EQ((*best2)->unassigned_cells.size, 0);
+    ASSERT_EQ((*best2)->vl_cells.size, (*best2)->vr_cells.size);
+
+    delete c;
+}
+
+TEST(Tree, balance_tolerance) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    p->initial_solution();
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+    while (t->dfs_step() != nullptr) {}
+    int exact_cost = (*best)->cost();
+    ASSERT_EQ(exact_cost, brute_force_cost(c));
+
+    ASSERT_TRUE(c->set_balance(0.1));
+    ASSERT_EQ(c->get_side_capacity(), 7);
+    ASSERT_FALSE(c->set_balance(0.5));
+    ASSERT_FALSE(c->set_balance(-0.1));
+    ASSERT_EQ(c->get_side_capacity(), 7);
+
+    a3::partition* p2 = new a3::partition(c);
+    a3::partition** best2 = &p2;
+    p2->initial_solution();
+    ASSERT_TRUE(p2->is_balanced());
+
+    traverser* t2 = new traverser(c, best2, prune_basic_cost);
+    t2->prune_symmetry = true;
+    while (t2->dfs_step() != nullptr) {}
+
+    ASSERT_EQ((*best2)->unassigned_cells.size, 0);
+    ASSERT_TRUE((*best2)->is_balanced());
+    ASSERT_LE((*best2)->vl_cells.size, 7);
+    ASSERT_LE((*best2)->vr_cells.size, 7);
+    ASSERT_LE((*best2)->cost(), exact_cost);
+    ASSERT_EQ((*best2)->cost(), brute_force_cost(c));
+
+    delete c;
+}
+
+TEST(Tree, fixed_cells) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+    ASSERT_TRUE(c->load_fixed("../data/cct1_fixed"));
+    ASSERT_EQ(c->get_n_fixed(), 3);
+    ASSERT_TRUE(c->get_fixed_left().get(1));
+    ASSERT_TRUE(c->get_fixed_right().get(5));
+
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    p->initial_solution();
+    ASSERT_TRUE(p->vl_cells.get(1));
+    ASSERT_TRUE(p->vr_cells.get(3));
+    ASSERT_TRUE(p->vr_cells.get(5));
+
+    // symmetry pruning has to back off when cells are pinned
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+    pnode* root = t->dfs_step();
+    ASSERT_EQ(root->p.unassigned_cells.size, 9);
+    ASSERT_TRUE(root->p.vr_cells.get(5));
+    while (t->dfs_step() != nullptr) {}
+
+    ASSERT_EQ((*best)->unassigned_cells.size, 0);
+    ASSERT_TRUE((*best)->vl_cells.get(1));
+    ASSERT_TRUE((*best)->vr_cells.get(3));
+    ASSERT_TRUE((*best)->vr_cells.get(5));
+    ASSERT_EQ((*best)->cost(), brute_force_cost(c));
+
+    delete c;
+}
+
 TEST(bitfield, basic) {
     for(unsigned long long i = 0; i < 128; ++i) {
         bitfield b = bitfield();
@@ -190,3 +546,335 @@ TEST(bitfield, union_with) {
     ASSERT_TRUE(b.union_with(a).get(36));
     ASSERT_FALSE(b.union_with(a).get(37));
 }
+
+TEST(Tree, components_match_brute_force) {
+    circuit* c = new circuit("../data/clusters");
+    spdlog::set_level(spdlog::level::info);
+
+    a3::partition* p = a3::solve_by_components(c, 2);
+    ASSERT_NE(p, nullptr);
+    ASSERT_TRUE(p->is_balanced());
+    ASSERT_EQ(p->unassigned_cells.size, 0);
+    ASSERT_EQ(p->cost(), brute_force_cost(c));
+    delete p;
+
+    // a tighter split has to cut into the clusters
+    c->set_capacities(5, 10);
+    p = a3::solve_by_components(c, 2);
+    ASSERT_EQ(p->vl_area, 5);
+    ASSERT_EQ(p->cost(), brute_force_cost(c));
+    delete p;
+
+    c->fix_cell(7, false);
+    c->fix_cell(8, true);
+    p = a3::solve_by_components(c, 2);
+    ASSERT_TRUE(p->vl_cells.get(7));
+    ASSERT_TRUE(p->vr_cells.get(8));
+    ASSERT_EQ(p->cost(), brute_force_cost(c));
+    delete p;
+
+    delete c;
+}
+
+TEST(Tree, reduced_matches_brute_force) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* original = new circuit("../data/reducible");
+    int expected = brute_force_cost(original);
+
+    // diving to deep nodes first already finds the cheap leaves reduction
+    // exposes, so there it need not save nodes, only never cost any
+    for (int ties = TIES_LIFO; ties <= TIES_DEEPEST; ++ties) {
+        unsigned long long nodes[2];
+        for (int reduce = 0; reduce < 2; ++reduce) {
+            circuit* c = new circuit("../data/reducible");
+            if (reduce) {
+                c->reduce();
+            }
+            // no heuristic start, so the node counts do not depend on luck
+            a3::partition* p = new a3::partition(c);
+            a3::partition** best = &p;
+            p->cut_weight = c->get_total_weight() + 1;
+            traverser* t = new traverser(c, best, prune_basic_cost);
+            t->prune_symmetry = true;
+            t->set_ties((tie_break)ties);
+            while (t->dfs_step() != nullptr) {}
+            ASSERT_EQ((*best)->cost(), expected);
+            nodes[reduce] = t->visited_nodes;
+            delete c;
+        }
+        ASSERT_LE(nodes[1], nodes[0]);
+        if (ties != TIES_DEEPEST) {
+            ASSERT_LT(nodes[1], nodes[0]);
+        }
+    }
+    delete original;
+}
+
+TEST(Tree, automorphisms_match_brute_force) {
+    spdlog::set_level(spdlog::level::info);
+    for (auto file : {"../data/slices", "../data/cct1"}) {
+        circuit* c = new circuit(file);
+        int expected = brute_force_cost(c);
+
+        unsigned long long nodes[2];
+        for (int symmetry = 0; symmetry < 2; ++symmetry) {
+            if (symmetry) {
+                c->find_symmetries();
+            }
+            a3::partition* p = new a3::partition(c);
+            a3::partition** best = &p;
+            p->cut_weight = c->get_total_weight() + 1;
+            traverser* t = new traverser(c, best, prune_basic_cost);
+            t->prune_symmetry = true;
+            while (t->dfs_step() != nullptr) {}
+            ASSERT_EQ((*best)->cost(), expected);
+            nodes[symmetry] = t->visited_nodes;
+        }
+        ASSERT_LE(nodes[1], nodes[0]);
+        if (c->get_automorphisms().size() > 0) {
+            ASSERT_LT(nodes[1], nodes[0]);
+        }
+        delete c;
+    }
+}
+
+TEST(Tree, nogoods_match_brute_force) {
+    spdlog::set_level(spdlog::level::info);
+    for (int run = 0; run < 3; ++run) {
+        circuit* c = new circuit(run == 1 ? "../data/weighted_test" : "../data/cct1");
+        if (run == 2) {
+            ASSERT_TRUE(c->load_fixed("../data/cct1_fixed"));
+        }
+        int expected = brute_force_cost(c);
+
+        for (int ida = 0; ida < 2; ++ida) {
+            unsigned long long nodes[2];
+            for (int learn = 0; learn < 2; ++learn) {
+                a3::partition* p = new a3::partition(c);
+                a3::partition** best = &p;
+                p->cut_weight = c->get_total_weight() + 1;
+                traverser* t = new traverser(c, best, prune_basic_cost);
+                t->prune_symmetry = true;
+                t->ida = ida;
+                t->learn_nogoods = learn;
+                // small enough that old nogoods get overwritten
+                t->nogood_limit = 64;
+                while ((ida ? t->ida_step() : t->dfs_step()) != nullptr) {}
+                ASSERT_EQ((*best)->cost(), expected);
+                nodes[learn] = t->visited_nodes;
+                if (learn) {
+                    ASSERT_NE(t->get_nogoods(), nullptr);
+                    ASSERT_LE(t->get_nogoods()->size(), 64);
+                }
+            }
+            ASSERT_LE(nodes[1], nodes[0]);
+        }
+        delete c;
+    }
+}
+
+TEST(Tree, transposition_table) {
+    spdlog::set_level(spdlog::level::info);
+    for (auto file : {"../data/cct1", "../data/slices"}) {
+        circuit* c = new circuit(file);
+        c->find_symmetries();
+        int expected = brute_force_cost(c);
+
+        unsigned long long nodes[2];
+        for (int use_tt = 0; use_tt < 2; ++use_tt) {
+            a3::partition* p = new a3::partition(c);
+            a3::partition** best = &p;
+            p->cut_weight = c->get_total_weight() + 1;
+            traverser* t = new traverser(c, best, prune_basic_cost);
+            t->prune_symmetry = true;
+            t->ida = true;
+            t->tt_megabytes = use_tt;
+            while (t->ida_step() != nullptr) {}
+            ASSERT_EQ((*best)->cost(), expected);
+            ASSERT_EQ(t->get_tt() != nullptr, use_tt == 1);
+            nodes[use_tt] = t->visited_nodes;
+        }
+        ASSERT_LE(nodes[1], nodes[0]);
+        delete c;
+    }
+
+    // least recently used states go first
+    transposition_table tt(0);
+    tt_key a = {1, 0, 0, bitfield(), bitfield(), bitfield()};
+    tt_key b = a;
+    b.left_nets.set(3);
+    tt.store(a, 5);
+    tt.store(b, 7);
+    int added;
+    ASSERT_FALSE(tt.lookup(a, added));
+    ASSERT_TRUE(tt.lookup(b, added));
+    ASSERT_EQ(added, 7);
+    tt.store(b, 4);
+    ASSERT_TRUE(tt.lookup(b, added));
+    ASSERT_EQ(added, 7);
+}
+
+// the bound state kept by assign matches a recount from the cell sets,
+// along random paths
+TEST(Partition, incremental_bound_state) {
+    circuit* c = new circuit("../data/cct2");
+    c->set_balance(0.1);
+    srand(7);
+    for (int run = 0; run < 20; ++run) {
+        a3::partition p(c);
+        std::vector<cell*> order = c->get_cells();
+        std::random_shuffle(order.begin(), order.end());
+        for (auto cl : order) {
+            bool right = rand() % 2;
+            if (right ? !p.fits_right(cl) : !p.fits_left(cl)) {
+                right = !right;
+            }
+            right ? p.assign_right(cl) : p.assign_left(cl);
+
+            int cut = 0;
+            for (auto n : c->get_nets()) {
+                int free_area = 0, free_pins = 0;
+                for (auto l : n->cell_labels.to_vec()) {
+                    if (p.unassigned_cells.get(l)) {
+                        free_area += c->get_cell(l)->area;
+                        free_pins++;
+                    }
+                }
+                ASSERT_EQ(p.net_free_area[n->label], free_area);
+                ASSERT_EQ(p.net_free_pins[n->label], free_pins);
+                bool on_left = n->cell_labels.intersection_with(p.vl_cells).size > 0;
+                bool on_right = n->cell_labels.intersection_with(p.vr_cells).size > 0;
+                ASSERT_EQ(p.cut_nets.get(n->label), on_left && on_right);
+                ASSERT_EQ(p.uncut_nets.get(n->label), !(on_left && on_right));
+                cut += (on_left && on_right) ? n->weight : 0;
+            }
+            ASSERT_EQ(p.cost(), cut);
+
+            for (auto l : p.unassigned_cells.to_vec()) {
+                int left_weight = 0, right_weight = 0;
+                for (auto nl : c->get_cell(l)->net_labels.to_vec()) {
+                    if (p.vl_nets.get(nl) && !p.vr_nets.get(nl)) {
+                        left_weight += c->get_net(nl)->weight;
+                    }
+                    if (p.vr_nets.get(nl) && !p.vl_nets.get(nl)) {
+                        right_weight += c->get_net(nl)->weight;
+                    }
+                }
+                ASSERT_EQ(p.anchored_left[l], left_weight);
+                ASSERT_EQ(p.anchored_right[l], right_weight);
+            }
+            ASSERT_GE(p.lb(), p.cost());
+        }
+    }
+    delete c;
+}
+
+TEST(Tree, bucket_queue) {
+    // heavy weights put costs far apart, past the window of buckets
+    for (int scale : {1, 100000000}) {
+        // cost, level
+        int spec[][2] = {{3, 1}, {1, 1}, {3, 4}, {1, 2}, {0, 5}, {3, 2}};
+        std::vector<pnode> pn(6);
+        for (int i = 0; i < 6; ++i) {
+            pn[i].p.cut_weight = spec[i][0]*scale;
+            pn[i].level = spec[i][1];
+        }
+        std::vector<std::vector<int>> expected = {
+            {4, 3, 1, 5, 2, 0},     // lifo
+            {4, 1, 3, 0, 2, 5},     // fifo
+            {4, 3, 1, 2, 5, 0},     // deepest
+        };
+        for (int ties = TIES_LIFO; ties <= TIES_DEEPEST; ++ties) {
+            pnode_queue q((tie_break)ties, 5);
+            for (int i = 0; i < 6; ++i) {
+                q.push(&pn[i]);
+            }
+            // listing and restoring keeps the pop order
+            std::vector<pnode*> listed = q.nodes();
+            pnode_queue r((tie_break)ties, 5);
+            r.restore(listed);
+            ASSERT_EQ(r.size(), 6);
+            for (int i = 0; i < 6; ++i) {
+                ASSERT_EQ(listed[i], &pn[expected[ties][i]]);
+                ASSERT_EQ(q.top(), &pn[expected[ties][i]]);
+                ASSERT_EQ(r.top(), &pn[expected[ties][i]]);
+                q.pop();
+                r.pop();
+            }
+            ASSERT_TRUE(q.empty());
+            ASSERT_TRUE(r.empty());
+        }
+    }
+}
+
+// a resumed ida run gets its table too
+TEST(Tree, transposition_table_resume) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* c = new circuit("../data/cct1");
+    c->find_symmetries();
+    int expected = brute_force_cost(c);
+
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    p->initial_solution();
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+    t->ida = true;
+    t->tt_megabytes = 1;
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_NE(t->ida_step(), nullptr);
+    }
+    ASSERT_TRUE(t->save_checkpoint("checkpoint_tt.ckpt"));
+
+    a3::partition* p2 = new a3::partition(c);
+    a3::partition** best2 = &p2;
+    traverser* t2 = new traverser(c, best2, prune_basic_cost);
+    t2->prune_symmetry = true;
+    t2->ida = true;
+    t2->tt_megabytes = 1;
+    ASSERT_TRUE(t2->load_checkpoint("checkpoint_tt.ckpt"));
+    ASSERT_NE(t2->get_tt(), nullptr);
+    while (t2->ida_step() != nullptr) {}
+    ASSERT_EQ((*best2)->cost(), expected);
+    ASSERT_GT(t2->get_tt()->size(), 0);
+    delete t;
+    delete t2;
+    delete c;
+}
+
+// a resumed search visits the same nodes under every tie break
+TEST(Tree, checkpoint_resume_ties) {
+    circuit* c = new circuit("../data/cct1");
+    spdlog::set_level(spdlog::level::info);
+    a3::partition* init = new a3::partition(c);
+    init->initial_solution();
+    for (int ties = TIES_LIFO; ties <= TIES_DEEPEST; ++ties) {
+        a3::partition* p = init;
+        a3::partition** best = &p;
+        traverser* t = new traverser(c, best, prune_basic_cost);
+        t->prune_symmetry = true;
+        t->set_ties((tie_break)ties);
+        while (t->dfs_step() != nullptr) {}
+
+        a3::partition* p2 = init;
+        a3::partition** best2 = &p2;
+        traverser* t2 = new traverser(c, best2, prune_basic_cost);
+        t2->prune_symmetry = true;
+        t2->set_ties((tie_break)ties);
+        for (int i = 0; i < 30; ++i) {
+            ASSERT_NE(t2->dfs_step(), nullptr);
+        }
+        ASSERT_TRUE(t2->save_checkpoint("checkpoint_ties.ckpt"));
+
+        a3::partition* p3 = new a3::partition(c);
+        a3::partition** best3 = &p3;
+        traverser* t3 = new traverser(c, best3, prune_basic_cost);
+        t3->prune_symmetry = true;
+        ASSERT_TRUE(t3->load_checkpoint("checkpoint_ties.ckpt"));
+        ASSERT_EQ(t3->get_ties(), ties);
+        while (t3->dfs_step() != nullptr) {}
+        ASSERT_EQ((*best3)->cost(), (*best)->cost());
+        ASSERT_EQ(t3->visited_nodes, t->visited_nodes);
+    }
+    delete c;
+}
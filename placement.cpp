@@ -0,0 +1,188 @@
+#include "placement.h"
+#include "kway.h"
+#include "thread_pool.h"
+#include <fstream>
+#include <cmath>
+#include <mutex>
+
+// min-cut placement: the grid is split in half along its longer side and the
+// cells with it, each half again, until every region holds one slot or one
+// cell.  regions of one level are independent, so they are bisected in
+// parallel; cell positions only change between levels.
+//
+// terminal propagation: a net that leaves the region is tied to a zero area
+// cell fixed on the side its outside pins lie on, judged from the centres
+// of the regions they currently sit in.  nets with outside pins on both sides
+// are cut whatever we do and are dropped.
+
+struct region {
+    int c0, r0, c1, r1;     // slots [c0, c1) x [r0, r1)
+    bitfield cells;
+
+    int slots() { return (c1 - c0)*(r1 - r0); }
+    double cx() { return (c0 + c1)/2.0; }
+    double cy() { return (r0 + r1)/2.0; }
+};
+
+static void put_at_center(circuit* c, region& r) {
+    // the slot nearest the centre, so cells land on grid points
+    double x = r.c0 + (r.c1 - r.c0)/2 + 0.5;
+    double y = r.r0 + (r.r1 - r.r0)/2 + 0.5;
+    for (auto cl : r.cells.to_vec()) {
+        c->get_cell(cl)->x = x;
+        c->get_cell(cl)->y = y;
+    }
+}
+
+// bisect one region; fills halves[0..1]
+static void split_region(circuit* c, region r, int terminal_label, unsigned long long node_limit, region* halves) {
+    bool vertical = (r.c1 - r.c0) >= (r.r1 - r.r0);
+    region lo = r, hi = r;
+    lo.cells = bitfield();
+    hi.cells = bitfield();
+    double cut;
+    if (vertical) {
+        lo.c1 = hi.c0 = r.c0 + (r.c1 - r.c0)/2;
+        cut = lo.c1;
+    } else {
+        lo.r1 = hi.r0 = r.r0 + (r.r1 - r.r0)/2;
+        cut = lo.r1;
+    }
+
+    bitfield keep_nets, to_left, to_right;
+    for (auto cl : r.cells.to_vec()) {
+        for (auto nl : c->get_cell(cl)->net_labels.to_vec()) {
+            if (keep_nets.get(nl) || to_left.get(nl) || to_right.get(nl)) {
+                continue;
+            }
+            bool outside_lo = false, outside_hi = false;
+            for (auto other : c->get_net(nl)->cell_labels.to_vec()) {
+                if (r.cells.get(other)) {
+                    continue;
+                }
+                cell* oc = c->get_cell(other);
+                double pos = vertical ? oc->x : oc->y;
+                if (pos < cut) {
+                    outside_lo = true;
+                } else {
+                    outside_hi = true;
+                }
+            }
+            if (outside_lo && outside_hi) {
+                continue;
+            }
+            keep_nets.set(nl);
+            if (outside_lo) {
+                to_left.set(nl);
+            } else if (outside_hi) {
+                to_right.set(nl);
+            }
+        }
+    }
+
+    circuit sub(c, r.cells, keep_nets);
+    if (to_left.size > 0) {
+        sub.add_fixed_cell(terminal_label, to_left, false);
+    }
+    if (to_right.size > 0) {
+        sub.add_fixed_cell(terminal_label + 1, to_right, true);
+    }
+    // one unit of area per slot
+    sub.set_capacities(lo.slots(), hi.slots());
+
+    a3::partition* p = a3::bisect(&sub, node_limit, true);
+    for (auto cl : p->vl_cells.to_vec()) {
+        if (r.cells.get(cl)) {
+            lo.cells.set(cl);
+        }
+    }
+    for (auto cl : p->vr_cells.to_vec()) {
+        if (r.cells.get(cl)) {
+            hi.cells.set(cl);
+        }
+    }
+    spdlog::debug("region [{},{})x[{},{}): {} | {} cells, cut {}",
+            r.c0, r.c1, r.r0, r.r1, lo.cells.size, hi.cells.size, p->cost());
+    delete p;
+
+    halves[0] = lo;
+    halves[1] = hi;
+}
+
+void a3::place(circuit* c, a3::placement_options& opt) {
+    int total = c->get_total_area();
+    if (opt.cols <= 0 || opt.rows <= 0) {
+        opt.cols = (int)ceil(sqrt((double)total));
+        opt.rows = (total + opt.cols - 1)/opt.cols;
+    }
+    if (opt.cols*opt.rows < total) {
+        spdlog::error("a {}x{} grid cannot hold {} area of cells", opt.cols, opt.rows, total);
+        return;
+    }
+
+    int max_label = 0;
+    for (auto cl : c->get_cells()) {
+        max_label = std::max(max_label, cl->label);
+    }
+    int terminal_label = max_label + 1;
+    if (terminal_label + 1 >= 64*BITFIELD_WORDS) {
+        spdlog::error("no cell labels left for propagated terminals");
+        return;
+    }
+
+    region all;
+    all.c0 = 0;
+    all.r0 = 0;
+    all.c1 = opt.cols;
+    all.r1 = opt.rows;
+    for (auto cl : c->get_cells()) {
+        all.cells.set(cl->label);
+    }
+
+    thread_pool pool(opt.n_threads);
+    spdlog::info("placing {} cells on a {}x{} grid with {} threads", c->get_n_cells(), opt.cols, opt.rows, pool.size());
+
+    std::vector<region> level = {all};
+    put_at_center(c, all);
+    while (!level.empty()) {
+        std::vector<region> to_split;
+        for (auto& r : level) {
+            if (r.slots() <= 1 || r.cells.size <= 1) {
+                put_at_center(c, r);
+            } else {
+                to_split.push_back(r);
+            }
+        }
+
+        std::vector<region> next(2*to_split.size());
+        for (size_t i = 0; i < to_split.size(); ++i) {
+            region* halves = &next[2*i];
+            region r = to_split[i];
+            unsigned long long limit = opt.node_limit;
+            pool.submit([c, r, terminal_label, limit, halves]() {
+                split_region(c, r, terminal_label, limit, halves);
+            });
+        }
+        pool.wait();
+
+        // positions move only here, so every region of a level saw the same picture
+        for (auto& r : next) {
+            put_at_center(c, r);
+        }
+        level = next;
+    }
+}
+
+// one 'cell x y' line per cell, after a header naming the grid
+bool a3::write_placement(circuit* c, std::string file, int cols, int rows) {
+    std::ofstream out(file);
+    if (!out.is_open()) {
+        spdlog::error("cannot write placement to {}", file);
+        return false;
+    }
+    out << "# a3 placement " << cols << " " << rows << std::endl;
+    for (auto cl : c->get_cells()) {
+        out << cl->label << " " << cl->x << " " << cl->y << std::endl;
+    }
+    return out.good();
+}
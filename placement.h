@@ -0,0 +1,17 @@
+#ifndef __PLACEMENT_H__
+#define __PLACEMENT_H__
+#include "circuit.h"
+#include <string>
+
+namespace a3 {
+    struct placement_options {
+        int cols;                       // grid size, 0 picks a square-ish grid
+        int rows;
+        int n_threads;
+        unsigned long long node_limit;  // per bisection, 0 means solve exactly
+    };
+
+    void place(circuit* c, placement_options& opt);
+    bool write_placement(circuit* c, std::string file, int cols, int rows);
+}
+#endif
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <utility>
+#include "circuit.h"
+#include "placement.h"
+
+TEST(Placement, one_cell_per_slot) {
+    circuit* c = new circuit("../data/cct1");
+    a3::placement_options opt = {0, 0, 2, 0};
+    a3::place(c, opt);
+    ASSERT_GE(opt.cols*opt.rows, c->get_total_area());
+
+    std::set<std::pair<double, double>> used;
+    for (auto cl : c->get_cells()) {
+        EXPECT_GT(cl->x, 0.0);
+        EXPECT_LT(cl->x, opt.cols);
+        EXPECT_GT(cl->y, 0.0);
+        EXPECT_LT(cl->y, opt.rows);
+        used.insert(std::make_pair(cl->x, cl->y));
+    }
+    EXPECT_EQ((int)used.size(), c->get_n_cells());
+    delete c;
+}
+
+// a wide grid forces uneven splits along one axis only
+TEST(Placement, wide_grid) {
+    circuit* c = new circuit("../data/cct1");
+    a3::placement_options opt = {8, 2, 1, 0};
+    a3::place(c, opt);
+
+    std::set<std::pair<double, double>> used;
+    for (auto cl : c->get_cells()) {
+        EXPECT_LT(cl->x, 8.0);
+        EXPECT_LT(cl->y, 2.0);
+        used.insert(std::make_pair(cl->x, cl->y));
+    }
+    EXPECT_EQ((int)used.size(), c->get_n_cells());
+    delete c;
+}
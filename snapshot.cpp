@@ -0,0 +1,56 @@
+#include "snapshot.h"
+#include <algorithm>
+
+search_monitor::search_monitor(size_t n_levels, int per_second, size_t n_recent) {
+    work.level_counts.assign(n_levels, 0);
+    work.density.assign(n_levels*DENSITY_BINS, 0);
+    recent.reserve(n_recent);
+    next_recent = 0;
+    period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::microseconds(1000000/per_second));
+    last = std::chrono::steady_clock::now();
+}
+
+void search_monitor::observe(traverser* t, pnode* pn) {
+    if ((size_t)pn->level < work.level_counts.size()) {
+        work.level_counts[pn->level]++;
+        double x = t->tree_x(pn->p.vr_cells, std::min(pn->level, DENSITY_BIN_LEVELS));
+        int bin = std::min(std::max((int)(x*DENSITY_BINS), 0), DENSITY_BINS - 1);
+        work.density[pn->level*DENSITY_BINS + bin]++;
+    }
+    observed o = {pn->p.vr_cells, pn->level, pn->p.cost()};
+    if (recent.size() < recent.capacity()) {
+        recent.push_back(o);
+    } else {
+        recent[next_recent] = o;
+        next_recent = (next_recent + 1) % recent.size();
+    }
+}
+
+void search_monitor::maybe_publish(traverser* t) {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last >= period) {
+        publish(t, false);
+        last = now;
+    }
+}
+
+void search_monitor::publish(traverser* t, bool done) {
+    work.visited_nodes = t->visited_nodes;
+    work.frontier_size = t->frontier_size();
+    work.best_cost = t->get_best()->cost();
+    work.best_left = t->get_best()->vl_cells;
+    work.best_right = t->get_best()->vr_cells;
+    work.done = done;
+    work.recent.resize(recent.size());
+    for (size_t i = 0; i < recent.size(); ++i) {
+        node_sample& s = work.recent[i];
+        s.x = t->tree_x(recent[i].right, recent[i].level);
+        s.parent_x = recent[i].level > 0 ? t->tree_x(recent[i].right, recent[i].level - 1) : s.x;
+        s.level = recent[i].level;
+        s.cost = recent[i].cost;
+    }
+    // assignment reuses the slot's storage once it has grown
+    buffer.write_slot() = work;
+    buffer.publish();
+}
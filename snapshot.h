@@ -0,0 +1,92 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cassert>
+#include "bitfield.h"
+#include "partition.h"
+
+// one expanded node, as much as the ui needs to draw it.  x is the
+// fraction of the tree's width, as in traverser::tree_x
+struct node_sample {
+    double x;
+    double parent_x;
+    int level;
+    int cost;
+};
+
+// each level's nodes are counted in this many bins across the tree.  a
+// node's bin is fixed by its first DENSITY_BIN_LEVELS decisions: deeper
+// ones never move it out of the span its ancestor there is centred in
+const int DENSITY_BIN_LEVELS = 8;
+const int DENSITY_BINS = 1 << DENSITY_BIN_LEVELS;
+
+// what the ui gets to see of a running search.  it is a copy, so drawing
+// never touches the traverser's nodes
+struct search_snapshot {
+    unsigned long long visited_nodes = 0;
+    size_t frontier_size = 0;
+    int best_cost = 0;
+    bitfield best_left;
+    bitfield best_right;
+    std::vector<unsigned long long> level_counts;   // nodes expanded per level
+    std::vector<unsigned> density;                  // level*DENSITY_BINS + bin
+    std::vector<node_sample> recent;                // most recently expanded nodes
+    bool done = false;
+};
+
+// single producer, single consumer triple buffer.  the writer fills its own
+// slot and swaps it with the middle one; the reader swaps the middle one for
+// its own when something new is there.  neither side ever waits
+template<typename T> class triple_buffer {
+    static const int FRESH = 4;
+    T slots[3];
+    std::atomic<int> middle;
+    int back;
+    int front;
+
+    public:
+        triple_buffer() : middle(1), back(0), front(2) {}
+        T& write_slot() { return slots[back]; }
+        void publish() { back = middle.exchange(back | FRESH) & ~FRESH; }
+        // true if read_slot() changed since the last call
+        bool update() {
+            if ((middle.load() & FRESH) == 0) {
+                return false;
+            }
+            front = middle.exchange(front) & ~FRESH;
+            return true;
+        }
+        T& read_slot() { return slots[front]; }
+};
+
+// watches the search from the solver thread and publishes a snapshot at
+// most once per period.  observe() is O(1), so it can sit in the hot loop;
+// maybe_publish() reads the clock, so it belongs between batches of steps.
+// a snapshot's size depends on the depth of the tree, not its size
+class search_monitor {
+    // a recent node as observed; where it is drawn is only worked out for
+    // the ones still here when a snapshot is published
+    struct observed {
+        bitfield right;
+        int level;
+        int cost;
+    };
+    search_snapshot work;
+    std::vector<observed> recent;
+    size_t next_recent;
+    triple_buffer<search_snapshot> buffer;
+    std::chrono::steady_clock::duration period;
+    std::chrono::steady_clock::time_point last;
+
+    public:
+        search_monitor(size_t n_levels, int per_second, size_t n_recent = 4096);
+        void observe(traverser* t, pnode* pn);
+        void maybe_publish(traverser* t);
+        void publish(traverser* t, bool done);
+        // latest published snapshot; only for the ui thread
+        search_snapshot& latest() { buffer.update(); return buffer.read_slot(); }
+};
+#endif
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include "circuit.h"
+#include "partition.h"
+#include "snapshot.h"
+
+TEST(Snapshot, triple_buffer) {
+    triple_buffer<int> b;
+    ASSERT_FALSE(b.update());
+    b.write_slot() = 1;
+    b.publish();
+    b.write_slot() = 2;
+    b.publish();
+    // only the newest counts, and only once
+    ASSERT_TRUE(b.update());
+    ASSERT_EQ(b.read_slot(), 2);
+    ASSERT_FALSE(b.update());
+    ASSERT_EQ(b.read_slot(), 2);
+    b.write_slot() = 3;
+    b.publish();
+    ASSERT_TRUE(b.update());
+    ASSERT_EQ(b.read_slot(), 3);
+}
+
+// the reader never sees a value go backwards or a torn pair
+TEST(Snapshot, triple_buffer_threads) {
+    triple_buffer<std::pair<long, long>> b;
+    std::atomic<bool> stop(false);
+    std::thread writer([&]() {
+        for (long i = 1; i <= 200000; ++i) {
+            b.write_slot() = std::make_pair(i, -i);
+            b.publish();
+        }
+        stop = true;
+    });
+    long last = 0;
+    while (!stop) {
+        b.update();
+        std::pair<long, long> v = b.read_slot();
+        ASSERT_GE(v.first, last);
+        ASSERT_EQ(v.first, -v.second);
+        last = v.first;
+    }
+    writer.join();
+    b.update();
+    ASSERT_EQ(b.read_slot().first, 200000);
+}
+
+// a search watched from another thread ends with a snapshot of its result
+TEST(Snapshot, monitor) {
+    spdlog::set_level(spdlog::level::info);
+    circuit* c = new circuit("../data/cct1");
+    a3::partition* p = new a3::partition(c);
+    a3::partition** best = &p;
+    p->cut_weight = c->get_total_weight() + 1;
+    traverser* t = new traverser(c, best, prune_basic_cost);
+    t->prune_symmetry = true;
+
+    search_monitor m(c->get_n_cells() + 1, 1000, 16);
+    std::thread solver([&]() {
+        auto observe = [&m, t](pnode* pn) { m.observe(t, pn); };
+        while (!t->step(64, observe).done) {
+            m.maybe_publish(t);
+        }
+        m.publish(t, true);
+    });
+    while (!m.latest().done) {
+        ASSERT_LE(m.latest().recent.size(), 16);
+    }
+    solver.join();
+
+    search_snapshot& s = m.latest();
+    ASSERT_EQ(s.visited_nodes, t->visited_nodes);
+    ASSERT_EQ(s.best_cost, (*best)->cost());
+    ASSERT_EQ(s.best_left.size + s.best_right.size, c->get_n_cells());
+    ASSERT_EQ(s.frontier_size, 0);
+    unsigned long long total = 0;
+    for (auto n : s.level_counts) {
+        total += n;
+    }
+    ASSERT_EQ(total, s.visited_nodes);
+    total = 0;
+    for (auto n : s.density) {
+        total += n;
+    }
+    ASSERT_EQ(total, s.visited_nodes);
+    ASSERT_EQ(s.recent.size(), 16);
+    // each level halves the spacing, and never runs out of room
+    for (auto& r : s.recent) {
+        ASSERT_GT(r.x, 0.0);
+        ASSERT_LT(r.x, 1.0);
+        if (r.level > 0) {
+            ASSERT_EQ(fabs(r.x - r.parent_x), ldexp(0.25, -(r.level - 1)));
+        }
+    }
+    delete c;
+}
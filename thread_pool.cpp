@@ -0,0 +1,62 @@
+#include "thread_pool.h"
+
+thread_pool::thread_pool(int n_threads) {
+    busy = 0;
+    stopping = false;
+    if (n_threads < 1) {
+        n_threads = 1;
+    }
+    for (int i = 0; i < n_threads; ++i) {
+        workers.emplace_back(&thread_pool::work, this);
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::unique_lock<std::mutex> lock(m);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+void thread_pool::submit(std::function<void()> job) {
+    {
+        std::unique_lock<std::mutex> lock(m);
+        jobs.push(job);
+    }
+    job_ready.notify_one();
+}
+
+void thread_pool::wait() {
+    std::unique_lock<std::mutex> lock(m);
+    all_done.wait(lock, [this]{ return jobs.empty() && busy == 0; });
+}
+
+void thread_pool::work() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            job_ready.wait(lock, [this]{ return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop();
+            busy++;
+        }
+
+        job();
+
+        {
+            std::unique_lock<std::mutex> lock(m);
+            busy--;
+            if (jobs.empty() && busy == 0) {
+                all_done.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// fixed set of workers pulling jobs off a shared queue.
+// jobs may submit more jobs; wait() returns once the queue has drained
+// and every worker is idle
+class thread_pool {
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex m;
+    std::condition_variable job_ready;
+    std::condition_variable all_done;
+    int busy;
+    bool stopping;
+    void work();
+
+    public:
+        thread_pool(int n_threads);
+        ~thread_pool();
+        void submit(std::function<void()> job);
+        void wait();
+        int size() { return workers.size(); }
+};
+#endif
@@ -0,0 +1,64 @@
+#include "transposition.h"
+#include <algorithm>
+
+bool tt_key::operator==(const tt_key& other) const {
+    return level == other.level && vl_area == other.vl_area && vr_area == other.vr_area &&
+        memcmp(left_nets.bits, other.left_nets.bits, sizeof(left_nets.bits)) == 0 &&
+        memcmp(right_nets.bits, other.right_nets.bits, sizeof(right_nets.bits)) == 0 &&
+        memcmp(symmetric_right.bits, other.symmetric_right.bits, sizeof(symmetric_right.bits)) == 0;
+}
+
+size_t tt_key_hash::operator()(const tt_key& k) const {
+    unsigned long long h = 14695981039346656037ULL;
+    auto mix = [&h](unsigned long long v) {
+        h ^= v;
+        h *= 1099511628211ULL;
+    };
+    mix(k.level);
+    mix(k.vl_area);
+    mix(k.vr_area);
+    for (int i = 0; i < BITFIELD_WORDS; ++i) {
+        mix(k.left_nets.bits[i]);
+        mix(k.right_nets.bits[i]);
+        mix(k.symmetric_right.bits[i]);
+    }
+    return h;
+}
+
+// a key is kept twice, in the list and the index, plus the node overheads
+static const size_t TT_ENTRY_BYTES = 2*sizeof(tt_key) + 64;
+
+transposition_table::transposition_table(size_t megabytes) {
+    capacity = megabytes*1024*1024/TT_ENTRY_BYTES;
+    if (capacity < 1) {
+        capacity = 1;
+    }
+    hits = 0;
+}
+
+bool transposition_table::lookup(const tt_key& k, int& added) {
+    auto it = index.find(k);
+    if (it == index.end()) {
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    added = it->second->second;
+    hits++;
+    return true;
+}
+
+// both the old and the new value are lower bounds, so keep the larger
+void transposition_table::store(const tt_key& k, int added) {
+    auto it = index.find(k);
+    if (it != index.end()) {
+        it->second->second = std::max(it->second->second, added);
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    if (entries.size() >= capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.push_front({k, added});
+    index[k] = entries.begin();
+}
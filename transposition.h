@@ -0,0 +1,46 @@
+#ifndef __TRANSPOSITION_H__
+#define __TRANSPOSITION_H__
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include "bitfield.h"
+
+// under a fixed cell order, two nodes at the same level have the same cells
+// left to place.  if they also agree on which uncut nets already have pins
+// on each side, on the area used on each side, and on the sides of the cells
+// symmetry breaking looks at, every completion adds the same cost to both
+struct tt_key {
+    int level;
+    int vl_area;
+    int vr_area;
+    bitfield left_nets;
+    bitfield right_nets;
+    bitfield symmetric_right;
+
+    bool operator==(const tt_key& other) const;
+};
+
+struct tt_key_hash {
+    size_t operator()(const tt_key& k) const;
+};
+
+// least cost a completion can add, for the most recently used states that
+// fit in the memory cap
+class transposition_table {
+    typedef std::list<std::pair<tt_key, int>> lru_list;
+    lru_list entries;
+    std::unordered_map<tt_key, lru_list::iterator, tt_key_hash> index;
+    size_t capacity;
+
+    public:
+        unsigned long long hits;
+
+        transposition_table(size_t megabytes);
+        bool lookup(const tt_key& k, int& added);
+        void store(const tt_key& k, int added);
+        size_t size() { return entries.size(); }
+};
+#endif
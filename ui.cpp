@@ -4,8 +4,13 @@
 #include "spdlog/spdlog.h"
 #include "circuit.h"
 #include "ui.h"
+#include "snapshot.h"
 #include <unistd.h>
 #include <sys/time.h>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
 using namespace std;
 
 // Callbacks for event-driven window handling.
@@ -19,7 +24,28 @@ float logic_cell_width = 10.0;
 circuit* circ;
 traverser* trav;
 
-pnode* (*run_fn)(circuit*, traverser*);
+void (*between_fn)(traverser*);
+
+// the search runs flat out on its own thread; the window only ever sees
+// the snapshots it publishes, redrawn at a fixed rate
+static const int UI_FPS = 30;
+// nodes per batch; between batches the solver publishes and pauses
+static const unsigned long long UI_STEP_NODES = 1024;
+search_monitor* monitor = nullptr;
+std::thread solver;
+std::atomic<bool> paused(false);
+
+void ui_solve() {
+    auto observe = [](pnode* pn) { monitor->observe(trav, pn); };
+    while (!trav->step(UI_STEP_NODES, observe).done) {
+        between_fn(trav);
+        monitor->maybe_publish(trav);
+        while (paused) {
+            usleep(1000000/UI_FPS);
+        }
+    }
+    monitor->publish(trav, true);
+}
 
 bool draw_cells = true;
 bool draw_rats_nest = true;
@@ -35,7 +61,7 @@ void ui_toggle_cell(void(*draw)()) {
     draw();
 }
 
-void ui_init(circuit* c, traverser* t, pnode* (*cb)(circuit*, traverser*)) {
+void ui_init(circuit* c, traverser* t, void (*cb)(traverser*)) {
     circ = c;
     trav = t;
     spdlog::info("Init UI");
@@ -44,23 +70,33 @@ void ui_init(circuit* c, traverser* t, pnode* (*cb)(circuit*, traverser*)) {
     create_button("TOGGLE RAT","TOGGLE CELL", ui_toggle_cell);
     init_world(0.,circ->get_display_width(),circ->get_display_height(),0.);
     set_keypress_input(true);
-    run_fn = cb;
+    between_fn = cb;
     //set_mouse_move_input(true);
 
-    set_interval(200000);
+    monitor = new search_monitor(circ->get_n_cells() + 1, UI_FPS);
+    solver = std::thread(ui_solve);
+
+    set_interval(1000000/UI_FPS);
     event_loop(ui_click_handler, ui_mouse_handler, ui_key_handler, ui_drawscreen);
+
+    // the window is done with, the search is not
+    paused = false;
+    spdlog::info("Waiting for the search to finish");
+    solver.join();
 }
 
 void ui_teardown() {
     close_graphics ();
+    delete monitor;
+    monitor = nullptr;
 }
 
 void ui_drawscreen() {
     set_draw_mode (DRAW_NORMAL);  // Should set this if your program does any XOR drawing in callbacks.
-    pnode* p = run_fn(circ, trav);
-    //if (p != nullptr)
-    //    ui_draw_pnode(p);
-    ui_draw(circ, trav);
+    // whole frames only, so redraws do not flicker
+    drawtobuffer();
+    ui_draw(circ, monitor->latest());
+    displaybuffer();
 }
 
 void ui_click_handler (float x, float y) {
@@ -73,39 +109,95 @@ void ui_mouse_handler (float x, float y) {
 
 void ui_key_handler(char c) {
 	spdlog::debug("keypress {}",c);
-    if (c=='n') {
-        spdlog::debug("NEXT",c);
-        clearscreen();
-        ui_drawscreen();
+    if (c=='p') {
+        paused = !paused;
+        spdlog::info("search {}", paused ? "paused" : "resumed");
     }
 }
 
-void ui_draw_pnode(pnode* p) {
+// a level's own nodes are drawn once they are this far apart on screen;
+// until then it is only a band of density bins
+static const float DETAIL_SPACING_PX = 24.0;
+// bin colours, emptiest first
+static const int HEAT[] = {DARKGREY, BLUE, CYAN, GREEN, YELLOW, RED};
+static const int N_HEAT = sizeof(HEAT)/sizeof(HEAT[0]);
+
+float ui_level_y(int level) {
+    return PNODE_DIAMETER/2.0 + level*PNODE_LEVEL_SPACING;
+}
+
+void ui_draw_sample(node_sample& s, float width) {
+    float x = s.x*width;
+    float y = ui_level_y(s.level);
     setcolor(GREEN);
     setlinewidth(2);
-    drawarc(p->x,p->y,PNODE_DIAMETER,0.,360.);
+    drawarc(x,y,PNODE_DIAMETER,0.,360.);
     setcolor(WHITE);
     setlinewidth(1);
-    if(p->parent != nullptr) {
-        drawline(p->x, p->y, p->parent->x, p->parent->y);
+    if(s.level > 0) {
+        drawline(x, y, s.parent_x*width, ui_level_y(s.level - 1));
     }
     char buf[32] = {0};
-    snprintf(buf,32,"%d [%d]",p->level, p->p.cost());
-    drawtext(p->x, p->y, buf, 2*PNODE_DIAMETER);
+    snprintf(buf,32,"%d [%d]",s.level, s.cost);
+    drawtext(x, y, buf, 2*PNODE_DIAMETER);
 }
 
-void ui_draw_traverser(traverser* t) {
-    for(auto& it : t->pnodes) {
-        ui_draw_pnode(it);
+// one band of bins per level, coloured by how many nodes were expanded
+// there on a log scale.  only the bins in view are drawn
+void ui_draw_density(search_snapshot& s, int level, float width, float x0, float x1, unsigned most) {
+    float bin_width = width/DENSITY_BINS;
+    int b0 = std::max(0, (int)floor(x0/bin_width));
+    int b1 = std::min(DENSITY_BINS - 1, (int)floor(x1/bin_width));
+    float y = ui_level_y(level);
+    for(int b = b0; b <= b1; ++b) {
+        unsigned n = s.density[level*DENSITY_BINS + b];
+        if (n == 0) {
+            continue;
+        }
+        int heat = (int)((N_HEAT - 1)*log2(1.0 + n)/log2(1.0 + most) + 0.5);
+        setcolor(HEAT[heat]);
+        fillrect(b*bin_width, y - PNODE_DIAMETER/2.0, (b + 1)*bin_width, y + PNODE_DIAMETER/2.0);
     }
 }
 
-void ui_draw(circuit* circ, traverser* t) {
-    static int count = 0;
-    count++;
-    //if (count%100 == 0)
-        clearscreen();
-    ui_draw_traverser(t);
-}
-
+// level of detail: the work per frame depends on the levels and bins in
+// view and the number of recent nodes, never on the size of the tree
+void ui_draw(circuit* circ, search_snapshot& s) {
+    t_report view;
+    report_structure(&view);
+    float width = circ->get_display_width();
+    float x0 = std::min(view.xleft, view.xright);
+    float x1 = std::max(view.xleft, view.xright);
+    float y0 = std::min(view.ytop, view.ybot);
+    float y1 = std::max(view.ytop, view.ybot);
+    float px_per_unit = view.top_width/(x1 - x0);
+
+    clearscreen();
+    int n_levels = s.level_counts.size();
+    int first = std::max(0, (int)floor((y0 - PNODE_DIAMETER)/PNODE_LEVEL_SPACING));
+    int last = std::min(n_levels - 1, (int)ceil((y1 + PNODE_DIAMETER)/PNODE_LEVEL_SPACING));
+
+    unsigned most = 1;
+    for(auto n : s.density) {
+        most = std::max(most, n);
+    }
+    std::vector<bool> detailed(std::max(n_levels, 0), false);
+    for(int l = first; l <= last; ++l) {
+        ui_draw_density(s, l, width, x0, x1, most);
+        // neighbouring nodes at level l are width/2^l apart
+        detailed[l] = ldexp(width, -l)*px_per_unit >= DETAIL_SPACING_PX;
+    }
+    for(auto& it : s.recent) {
+        float x = it.x*width;
+        if (it.level >= first && it.level <= last && detailed[it.level] &&
+                x >= x0 - PNODE_DIAMETER && x <= x1 + PNODE_DIAMETER) {
+            ui_draw_sample(it, width);
+        }
+    }
 
+    char msg[128] = {0};
+    snprintf(msg, 128, "%s: %llu nodes, frontier %zu, best cut %d   (p: pause)",
+            s.done ? "done" : (paused ? "paused" : "searching"),
+            s.visited_nodes, s.frontier_size, s.best_cost);
+    update_message(msg);
+}
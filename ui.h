@@ -2,11 +2,12 @@
 #define __UI_H__
 #include "circuit.h"
 #include "partition.h"
+#include "snapshot.h"
 #include <string>
 using namespace std;
-void ui_init(circuit*, traverser* trav, pnode* (*run_fn)(circuit*,traverser*));
+void ui_init(circuit*, traverser* trav, void (*between_fn)(traverser*));
 void ui_teardown();
 
-void ui_draw(circuit*, traverser*);
-void ui_draw_pnode(pnode* p);
+void ui_draw(circuit*, search_snapshot& s);
+void ui_draw_sample(node_sample& s, float width);
 #endif